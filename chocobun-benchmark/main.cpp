@@ -0,0 +1,174 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Solver benchmark
+//
+// Solves every level of a collection once with each lower bound
+// (see Solver::Heuristic) and compares the number of positions
+// expanded. The collection file is only read, never saved.
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/CollectionParser.hpp>
+#include <core/Exception.hpp>
+#include <core/Level.hpp>
+#include <core/Solver.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace Chocobun;
+
+namespace {
+
+// --------------------------------------------------------------
+// totals of the levels solved with both lower bounds
+struct Totals
+{
+    Uint64 nodesExpanded[2];
+    double seconds[2];
+    Uint32 solved[2];
+    Uint32 solvedByBoth;
+};
+
+// --------------------------------------------------------------
+const char* getResultName( Solver::Result result )
+{
+    switch( result )
+    {
+        case Solver::RESULT_SOLVED: return "solved";
+        case Solver::RESULT_UNSOLVABLE: return "unsolvable";
+        case Solver::RESULT_LIMIT_REACHED: return "limit";
+    }
+    return "";
+}
+
+} // namespace
+
+// --------------------------------------------------------------
+// main entry point
+int main( int argc, char** argv )
+{
+    if( argc < 2 )
+    {
+        std::cerr << "usage: " << argv[0] << " <collection file> [time limit per level] [astar|idastar|parallel|bidirectional] [thread count]" << std::endl;
+        return 1;
+    }
+    double timeLimit = argc > 2 ? std::atof( argv[2] ) : 10.0;
+    Solver::Mode mode = Solver::MODE_ASTAR;
+    if( argc > 3 )
+    {
+        if( std::strcmp( argv[3], "idastar" ) == 0 ) mode = Solver::MODE_IDASTAR;
+        else if( std::strcmp( argv[3], "parallel" ) == 0 ) mode = Solver::MODE_PARALLEL;
+        else if( std::strcmp( argv[3], "bidirectional" ) == 0 ) mode = Solver::MODE_BIDIRECTIONAL;
+        else if( std::strcmp( argv[3], "astar" ) != 0 )
+        {
+            std::cerr << "unknown mode \"" << argv[3] << "\"" << std::endl;
+            return 1;
+        }
+    }
+    Uint32 threadCount = argc > 4 ? static_cast<Uint32>( std::atoi( argv[4] ) ) : 0;
+
+    std::vector<Level*> levels;
+    try
+    {
+        CollectionParser parser;
+        parser.parse( argv[1], levels );
+    }catch( const Exception& e )
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    const Solver::Heuristic heuristics[2] = { Solver::HEURISTIC_GREEDY, Solver::HEURISTIC_MATCHING };
+    Totals totals = Totals();
+    std::cout << std::left << std::setw(24) << "level" << std::right
+              << std::setw(8) << "pushes"
+              << std::setw(14) << "greedy" << std::setw(14) << "matching"
+              << std::setw(10) << "ratio"
+              << std::setw(10) << "greedy s" << std::setw(10) << "match s" << std::endl;
+
+    for( std::vector<Level*>::iterator it = levels.begin(); it != levels.end(); ++it )
+    {
+        Level& level = **it;
+        std::cout << std::left << std::setw(24) << level.getLevelName().substr( 0, 23 ) << std::right;
+        if( !level.validateLevel() )
+        {
+            std::cout << "invalid" << std::endl;
+            continue;
+        }
+
+        Solver::Result results[2];
+        Solver::Statistics statistics[2];
+        for( Uint32 i = 0; i != 2; ++i )
+        {
+            Solver solver;
+            solver.setMode( mode );
+            solver.setThreadCount( threadCount );
+            solver.setHeuristic( heuristics[i] );
+            solver.setTimeLimit( timeLimit );
+            results[i] = solver.solve( level );
+            statistics[i] = solver.getStatistics();
+            if( results[i] == Solver::RESULT_SOLVED )
+                ++totals.solved[i];
+        }
+
+        std::cout << std::setw(8);
+        if( results[1] == Solver::RESULT_SOLVED ) std::cout << statistics[1].pushes;
+        else if( results[0] == Solver::RESULT_SOLVED ) std::cout << statistics[0].pushes;
+        else std::cout << "-";
+        for( Uint32 i = 0; i != 2; ++i )
+        {
+            std::cout << std::setw(14);
+            if( results[i] == Solver::RESULT_SOLVED ) std::cout << statistics[i].nodesExpanded;
+            else std::cout << getResultName( results[i] );
+        }
+        std::cout << std::setw(10);
+        if( results[0] == Solver::RESULT_SOLVED && results[1] == Solver::RESULT_SOLVED && statistics[1].nodesExpanded )
+            std::cout << std::fixed << std::setprecision(2) << double(statistics[0].nodesExpanded) / statistics[1].nodesExpanded;
+        else
+            std::cout << "-";
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(10) << statistics[0].seconds << std::setw(10) << statistics[1].seconds << std::endl;
+
+        if( results[0] == Solver::RESULT_SOLVED && results[1] == Solver::RESULT_SOLVED )
+        {
+            ++totals.solvedByBoth;
+            for( Uint32 i = 0; i != 2; ++i )
+            {
+                totals.nodesExpanded[i] += statistics[i].nodesExpanded;
+                totals.seconds[i] += statistics[i].seconds;
+            }
+        }
+    }
+
+    std::cout << std::endl
+              << "solved: " << totals.solved[0] << " greedy, " << totals.solved[1] << " matching, out of " << levels.size() << std::endl
+              << "positions expanded on the " << totals.solvedByBoth << " levels solved by both: "
+              << totals.nodesExpanded[0] << " greedy (" << totals.seconds[0] << " s), "
+              << totals.nodesExpanded[1] << " matching (" << totals.seconds[1] << " s)" << std::endl;
+
+    for( std::vector<Level*>::iterator it = levels.begin(); it != levels.end(); ++it )
+        delete *it;
+    return 0;
+}
@@ -28,10 +28,27 @@
 #include <iostream>
 #include <fstream>
 
+#ifndef _WIN32
+#   include <unistd.h>
+#endif
+
+// --------------------------------------------------------------
+// checks if standard output supports ANSI escape sequences
+static bool isAnsiTerminal( void )
+{
+#ifdef _WIN32
+    return false;
+#else
+    return isatty( STDOUT_FILENO ) != 0;
+#endif
+}
+
 // --------------------------------------------------------------
 // constructor
 App::App( void ) :
-    m_Collection(0)
+    m_Collection(0),
+    m_LevelWasSolved(false),
+    m_Renderer( std::cout, isAnsiTerminal() )
 {
 }
 
@@ -42,6 +59,12 @@ App::~App( void )
     if( m_Collection ) delete m_Collection;
 }
 
+// --------------------------------------------------------------
+void App::onLevelSolved( const Chocobun::Level& level )
+{
+    m_LevelWasSolved = true;
+}
+
 // --------------------------------------------------------------
 void App::go( void )
 {
@@ -62,6 +85,10 @@ void App::go( void )
         std::string input;
         std::getline( std::cin, input );
 
+        // the renderer can only update the level in place if nothing else
+        // was printed since the last frame
+        bool levelIsLastOutput = false;
+
         // switch/case block
         for(;;)
         {
@@ -119,6 +146,8 @@ void App::go( void )
                             delete m_Collection;
                         m_Collection = new Chocobun::Collection( fileName );
                         m_Collection->initialise();
+                        m_Collection->addListener( this );
+                        m_Collection->addListener( &m_Renderer );
                         std::cout << "Successfully opened collection \"" << fileName << "\"" << std::endl;
                     }
                 }
@@ -210,7 +239,9 @@ void App::go( void )
                         }else
                         {
                             std::cout << "Opened level \"" << argList.at( argList.size()-1 ) << std::endl;
-                            m_Collection->streamTileData( std::cout );
+                            m_Renderer.invalidate();
+                            m_Renderer.render( *m_Collection );
+                            levelIsLastOutput = true;
                         }
                     }else
                     {
@@ -218,6 +249,20 @@ void App::go( void )
                     }
                 }
 
+                // reset level
+                if( reset )
+                {
+                    if( !m_Collection->hasActiveLevel() )
+                    {
+                        std::cout << "Error: There's no open level." << std::endl;
+                    }else
+                    {
+                        m_Collection->reset();
+                        m_Renderer.render( *m_Collection );
+                        levelIsLastOutput = true;
+                    }
+                }
+
                 break;
             }
 
@@ -244,26 +289,33 @@ void App::go( void )
                     break;
                 }
 
-                // process movement letters
-                for( size_t pos = 0; pos != argList[0].size(); ++pos )
+                // process movement letters. Runs of moves are applied in one
+                // go, applyMoves stops at anything it can't apply
+                m_LevelWasSolved = false;
+                const std::string& moves = argList[0];
+                for( size_t pos = 0; pos != moves.size(); )
                 {
-                    if( argList[0][pos] == 'u' )
-                        {m_Collection->moveUp(); continue; }
-                    if( argList[0][pos] == 'd' )
-                        {m_Collection->moveDown(); continue; }
-                    if( argList[0][pos] == 'l' )
-                        {m_Collection->moveLeft(); continue; }
-                    if( argList[0][pos] == 'r' )
-                        {m_Collection->moveRight(); continue; }
-                    if( argList[0][pos] == 'z' )
+                    pos += m_Collection->applyMoves( moves.c_str() + pos, moves.size() - pos );
+                    if( pos == moves.size() ) break;
+                    char move = moves[pos++];
+                    if( std::string("udlrUDLR").find( move ) != std::string::npos )
+                        continue; // blocked moves are silently skipped
+                    if( move == 'z' )
                         {m_Collection->undo(); continue; }
-                    if( argList[0][pos] == 'Z')
+                    if( move == 'Z')
                         {m_Collection->redo(); continue; }
-                    std::cout << "Warning: Unkown move command \"" << argList[0][pos] << "\". Skipping..." << std::endl;
+                    std::cout << "Warning: Unkown move command \"" << move << "\". Skipping..." << std::endl;
+                    m_Renderer.invalidate();
                 }
 
-                // redraw level
-                m_Collection->streamTileData( std::cout );
+                // redraw level. All moves of the command are drawn as one frame
+                m_Renderer.render( *m_Collection );
+                levelIsLastOutput = true;
+                if( m_LevelWasSolved )
+                {
+                    std::cout << "Congratulations, you solved the level!" << std::endl;
+                    levelIsLastOutput = false;
+                }
 
                 break;
             }
@@ -272,6 +324,8 @@ void App::go( void )
             std::cout << "Error: Unknown command \"" << argList[0] << "\"" << std::endl;
             break;
         }
+        if( !levelIsLastOutput )
+            m_Renderer.invalidate();
 
     }
 }
@@ -25,6 +25,9 @@
 // --------------------------------------------------------------
 // include files
 
+#include <core/LevelListener.hpp>
+#include <Renderer.hpp>
+
 #include <iostream>
 #include <vector>
 
@@ -38,7 +41,7 @@ namespace Chocobun {
 /*!
  * @brief The application object
  */
-class App
+class App : public Chocobun::LevelListener
 {
 public:
 
@@ -59,6 +62,11 @@ public:
      */
     void go( void );
 
+    /*!
+     * @brief Remembers that a move solved the level, so it is congratulated once
+     */
+    void onLevelSolved( const Chocobun::Level& level );
+
 private:
 
     /*!
@@ -77,6 +85,8 @@ private:
     bool displayHelp( const std::string& cmd );
 
     Chocobun::Collection* m_Collection;
+    bool m_LevelWasSolved;
+    Renderer m_Renderer;
 };
 
 #endif // __APP_HPP__
@@ -0,0 +1,159 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Renderer
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <Renderer.hpp>
+#include <core/Collection.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+using Chocobun::Uint32;
+using Chocobun::Int32;
+
+// --------------------------------------------------------------
+// constructor
+Renderer::Renderer( std::ostream& stream, bool useAnsi ) :
+    m_Stream( stream ),
+    m_UseAnsi( useAnsi ),
+    m_SizeX( 0 ),
+    m_SizeY( 0 ),
+    m_FrontBufferIsValid( false ),
+    m_AllTilesChanged( false )
+{
+}
+
+// --------------------------------------------------------------
+// destructor
+Renderer::~Renderer( void )
+{
+}
+
+// --------------------------------------------------------------
+void Renderer::invalidate( void )
+{
+    m_FrontBufferIsValid = false;
+}
+
+// --------------------------------------------------------------
+void Renderer::render( const Chocobun::Collection& collection )
+{
+    const std::vector< std::vector<char> >& tiles = collection.getTileData();
+    m_Frame.clear();
+
+    // draw everything if the screen can't be patched
+    if( !m_UseAnsi || !m_FrontBufferIsValid ||
+        m_SizeX != collection.getSizeX() || m_SizeY != collection.getSizeY() )
+    {
+        m_SizeX = collection.getSizeX();
+        m_SizeY = collection.getSizeY();
+        this->renderFull( tiles );
+    }else
+        this->renderChanges( tiles );
+
+    m_ChangedTiles.clear();
+    m_AllTilesChanged = false;
+
+    m_Stream.write( m_Frame.data(), m_Frame.size() );
+    m_Stream.flush();
+}
+
+// --------------------------------------------------------------
+void Renderer::onTilesChanged( const Chocobun::Level& level, const Chocobun::TileChange* changes, Uint32 count )
+{
+    if( m_AllTilesChanged ) return;
+    for( Uint32 i = 0; i != count; ++i )
+        m_ChangedTiles.push_back( changes[i].y * m_SizeX + changes[i].x );
+
+    // past this point comparing every tile is cheaper than sorting the list
+    if( m_ChangedTiles.size() > m_FrontBuffer.size() )
+        m_AllTilesChanged = true;
+}
+
+// --------------------------------------------------------------
+void Renderer::onLevelChanged( const Chocobun::Level& level )
+{
+    m_AllTilesChanged = true;
+}
+
+// --------------------------------------------------------------
+void Renderer::renderFull( const std::vector< std::vector<char> >& tiles )
+{
+    m_FrontBuffer.resize( m_SizeX * m_SizeY );
+    for( Uint32 y = 0; y != m_SizeY; ++y )
+    {
+        for( Uint32 x = 0; x != m_SizeX; ++x )
+        {
+            m_FrontBuffer[y*m_SizeX + x] = tiles[x][y];
+            m_Frame += tiles[x][y];
+        }
+        m_Frame += '\n';
+    }
+    m_FrontBufferIsValid = true;
+}
+
+// --------------------------------------------------------------
+void Renderer::renderChanges( const std::vector< std::vector<char> >& tiles )
+{
+    // the cursor is on the line below the command the user typed, which
+    // itself is on the line below the level
+    Int32 cursorRow = m_SizeY + 1;
+
+    if( m_AllTilesChanged )
+    {
+        m_ChangedTiles.clear();
+        for( Uint32 i = 0; i != m_FrontBuffer.size(); ++i )
+            m_ChangedTiles.push_back( i );
+    }else
+        std::sort( m_ChangedTiles.begin(), m_ChangedTiles.end() );
+
+    for( std::vector<Uint32>::iterator it = m_ChangedTiles.begin(); it != m_ChangedTiles.end(); ++it )
+    {
+        Uint32 x = *it % m_SizeX;
+        Uint32 y = *it / m_SizeX;
+        char tile = tiles[x][y];
+        if( m_FrontBuffer[*it] == tile ) continue;
+        m_FrontBuffer[*it] = tile;
+
+        // move to the tile and overwrite it
+        std::ostringstream column;
+        column << "\x1b[" << x+1 << "G";
+        this->moveCursor( Int32(y) - cursorRow );
+        m_Frame += column.str();
+        m_Frame += tile;
+        cursorRow = y;
+    }
+
+    // return to the line below the level and erase the user's command
+    this->moveCursor( Int32(m_SizeY) - cursorRow );
+    m_Frame += "\r\x1b[J";
+}
+
+// --------------------------------------------------------------
+void Renderer::moveCursor( Int32 rows )
+{
+    if( rows == 0 ) return;
+    std::ostringstream sequence;
+    sequence << "\x1b[" << (rows < 0 ? -rows : rows) << (rows < 0 ? "A" : "B");
+    m_Frame += sequence.str();
+}
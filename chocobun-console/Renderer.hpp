@@ -0,0 +1,135 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Renderer
+// --------------------------------------------------------------
+
+#ifndef __RENDERER_HPP__
+#define __RENDERER_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/LevelListener.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------------
+// forward declarations
+
+namespace Chocobun {
+    class Collection;
+}
+
+/*!
+ * @brief Draws the active level to the terminal
+ *
+ * The renderer listens to the tile changes of the active level and collects
+ * them until the next frame is rendered. When a frame is rendered, only the
+ * tiles which differ from what is already on screen are written, using ANSI
+ * escape sequences to position the cursor. The whole frame is assembled in
+ * memory and written to the stream at once, so there is a single write and
+ * flush per frame.
+ *
+ * Moves applied between two frames are coalesced: replaying thousands of
+ * moves only draws the tiles which ended up different.
+ *
+ * The board is expected to be the last thing on screen, followed by the
+ * line the user typed the command on. If anything else was written in
+ * between, call invalidate() so the next frame is drawn in full.
+ */
+class Renderer : public Chocobun::LevelListener
+{
+public:
+
+    /*!
+     * @brief Constructor
+     *
+     * @param stream The stream to render to
+     * @param useAnsi If false, escape sequences are never used and every
+     * frame draws the entire level
+     */
+    Renderer( std::ostream& stream, bool useAnsi );
+
+    /*!
+     * @brief Destructor
+     */
+    ~Renderer( void );
+
+    /*!
+     * @brief Forces the next frame to draw the entire level
+     *
+     * Call this whenever something other than the user's command was printed
+     * after the last frame, or a different level was opened.
+     */
+    void invalidate( void );
+
+    /*!
+     * @brief Renders a frame of the active level of a collection
+     *
+     * @param collection The collection to render. It must have an active level
+     */
+    void render( const Chocobun::Collection& collection );
+
+    /*!
+     * @brief Collects changed tiles for the next frame
+     */
+    void onTilesChanged( const Chocobun::Level& level, const Chocobun::TileChange* changes, Chocobun::Uint32 count );
+
+    /*!
+     * @brief Marks every tile as possibly changed for the next frame
+     */
+    void onLevelChanged( const Chocobun::Level& level );
+
+private:
+
+    /*!
+     * @brief Writes the entire level and updates the front buffer
+     */
+    void renderFull( const std::vector< std::vector<char> >& tiles );
+
+    /*!
+     * @brief Writes only the tiles that changed since the last frame
+     */
+    void renderChanges( const std::vector< std::vector<char> >& tiles );
+
+    /*!
+     * @brief Appends a relative cursor movement escape sequence to the frame
+     */
+    void moveCursor( Chocobun::Int32 rows );
+
+    std::ostream& m_Stream;
+    bool m_UseAnsi;
+
+    // what is currently on screen, stored row-major
+    std::vector<char> m_FrontBuffer;
+    Chocobun::Uint32 m_SizeX;
+    Chocobun::Uint32 m_SizeY;
+    bool m_FrontBufferIsValid;
+
+    // tiles changed since the last frame, stored as row-major indices
+    std::vector<Chocobun::Uint32> m_ChangedTiles;
+    bool m_AllTilesChanged;
+
+    // the frame being assembled
+    std::string m_Frame;
+};
+
+#endif // __RENDERER_HPP__
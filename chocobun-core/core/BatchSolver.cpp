@@ -0,0 +1,200 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Batch solver
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/BatchSolver.hpp>
+#include <core/Level.hpp>
+#include <core/Exception.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace Chocobun {
+
+namespace {
+
+// --------------------------------------------------------------
+const char* getResultName( Solver::Result result )
+{
+    switch( result )
+    {
+        case Solver::RESULT_SOLVED: return "solved";
+        case Solver::RESULT_UNSOLVABLE: return "unsolvable";
+        case Solver::RESULT_LIMIT_REACHED: return "limit";
+    }
+    return "";
+}
+
+// --------------------------------------------------------------
+// takes levels off the shared counter until there are none left
+void work( const Solver& prototype, const std::vector<Level>& levels, std::atomic<Uint32>& nextLevel,
+           std::vector<BatchSolver::LevelReport>& reports, std::vector<std::string>& solutions )
+{
+    Solver solver( prototype );
+    for( Uint32 i = nextLevel++; i < levels.size(); i = nextLevel++ )
+    {
+        BatchSolver::LevelReport& report = reports[i];
+        if( !report.isValid ) continue;
+        try
+        {
+            report.result = solver.solve( levels[i] );
+            report.statistics = solver.getStatistics();
+            if( report.result == Solver::RESULT_SOLVED )
+                solutions[i] = solver.getSolution();
+        }catch( const Exception& )
+        {
+            // e.g. too large to search
+            report.isValid = false;
+        }
+    }
+}
+
+} // namespace
+
+// --------------------------------------------------------------
+BatchSolver::BatchSolver( void ) :
+    m_ThreadCount( 0 )
+{
+    m_Solver.setTimeLimit( 10 );
+    m_Report = Report();
+}
+
+// --------------------------------------------------------------
+BatchSolver::~BatchSolver( void )
+{
+}
+
+// --------------------------------------------------------------
+Solver& BatchSolver::getSolver( void )
+{
+    return m_Solver;
+}
+
+// --------------------------------------------------------------
+void BatchSolver::setThreadCount( Uint32 count )
+{
+    m_ThreadCount = count;
+}
+
+// --------------------------------------------------------------
+Uint32 BatchSolver::getThreadCount( void ) const
+{
+    return m_ThreadCount;
+}
+
+// --------------------------------------------------------------
+void BatchSolver::solve( std::vector<Level*>& levels )
+{
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    m_Report = Report();
+    m_Report.levels.resize( levels.size() );
+
+    // validating changes the levels, so it is done here rather than by
+    // the threads. The threads get copies of their own
+    std::vector<Level> starts;
+    starts.reserve( levels.size() );
+    for( Uint32 i = 0; i != levels.size(); ++i )
+    {
+        m_Report.levels[i].levelName = levels[i]->getLevelName();
+        m_Report.levels[i].isValid = levels[i]->validateLevel();
+        starts.push_back( *levels[i] );
+    }
+
+    // hardware_concurrency() may not know and return 0
+    Uint32 threadCount = m_ThreadCount;
+    if( threadCount == 0 )
+        threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+    threadCount = std::min( threadCount, std::max( static_cast<Uint32>( levels.size() ), 1u ) );
+
+    std::atomic<Uint32> nextLevel( 0 );
+    std::vector<std::string> solutions( levels.size() );
+    std::vector<std::thread> threads;
+    for( Uint32 i = 0; i != threadCount; ++i )
+        threads.push_back( std::thread( work, std::cref( m_Solver ), std::cref( starts ), std::ref( nextLevel ),
+                                        std::ref( m_Report.levels ), std::ref( solutions ) ) );
+    for( Uint32 i = 0; i != threads.size(); ++i )
+        threads[i].join();
+
+    // the levels are only changed once the threads are done with them.
+    // Dropping the copies first keeps the levels from copying their static
+    // data on write (see Level::getWritableStaticData)
+    starts.clear();
+    for( Uint32 i = 0; i != levels.size(); ++i )
+    {
+        const LevelReport& report = m_Report.levels[i];
+        if( !report.isValid )
+        {
+            ++m_Report.invalid;
+            continue;
+        }
+        switch( report.result )
+        {
+            case Solver::RESULT_SOLVED:
+                ++m_Report.solved;
+                levels[i]->setMetaData( "Solution", solutions[i] );
+                break;
+            case Solver::RESULT_UNSOLVABLE: ++m_Report.unsolvable; break;
+            case Solver::RESULT_LIMIT_REACHED: ++m_Report.limitReached; break;
+        }
+    }
+    m_Report.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+}
+
+// --------------------------------------------------------------
+const BatchSolver::Report& BatchSolver::getReport( void ) const
+{
+    return m_Report;
+}
+
+// --------------------------------------------------------------
+void BatchSolver::streamReport( std::ostream& stream ) const
+{
+    stream << std::left << std::setw(24) << "level" << std::right
+           << std::setw(12) << "result" << std::setw(8) << "pushes" << std::setw(8) << "moves"
+           << std::setw(14) << "positions" << std::setw(10) << "seconds" << std::endl;
+    for( std::vector<LevelReport>::const_iterator it = m_Report.levels.begin(); it != m_Report.levels.end(); ++it )
+    {
+        stream << std::left << std::setw(24) << it->levelName.substr( 0, 23 ) << std::right;
+        if( !it->isValid )
+        {
+            stream << std::setw(12) << "invalid" << std::endl;
+            continue;
+        }
+        stream << std::setw(12) << getResultName( it->result );
+        if( it->result == Solver::RESULT_SOLVED )
+            stream << std::setw(8) << it->statistics.pushes << std::setw(8) << it->statistics.moves;
+        else
+            stream << std::setw(8) << "-" << std::setw(8) << "-";
+        stream << std::setw(14) << it->statistics.nodesExpanded
+               << std::setw(10) << std::fixed << std::setprecision(2) << it->statistics.seconds << std::endl;
+    }
+    stream << std::endl
+           << m_Report.solved << " solved, " << m_Report.unsolvable << " unsolvable, "
+           << m_Report.limitReached << " out of limits, " << m_Report.invalid << " invalid, out of "
+           << m_Report.levels.size() << " levels in " << std::fixed << std::setprecision(2) << m_Report.seconds << " s" << std::endl;
+}
+
+} // namespace Chocobun
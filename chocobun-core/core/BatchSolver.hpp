@@ -0,0 +1,146 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Batch solver
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_BATCH_SOLVER_HPP__
+#define __CHOCOBUN_CORE_BATCH_SOLVER_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/Export.hpp>
+#include <core/Solver.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Chocobun {
+
+// --------------------------------------------------------------
+// forward declarations
+
+class Level;
+
+/*!
+ * @brief Solves many levels at once on a pool of threads
+ *
+ * Every thread takes the next level nobody is working on yet and solves it
+ * with its own copy of getSolver(), so each level gets the limits set
+ * there. The levels themselves are the unit of work, so the solver should
+ * use a single threaded mode. Solutions found are attached to the levels
+ * as "Solution" meta data, which is saved with them (see
+ * Collection::solveAll).
+ */
+class CHOCOBUN_CORE_API BatchSolver
+{
+public:
+
+    /*!
+     * @brief The outcome of solving a single level
+     */
+    struct LevelReport
+    {
+        std::string levelName;
+        bool isValid;                   //!< False if the level failed Level::validateLevel or couldn't be searched, the other fields are unset then
+        Solver::Result result;
+        Solver::Statistics statistics;
+    };
+
+    /*!
+     * @brief The outcome of solving all levels
+     */
+    struct Report
+    {
+        std::vector<LevelReport> levels;   //!< In the order the levels were passed in
+        Uint32 solved;
+        Uint32 unsolvable;
+        Uint32 limitReached;
+        Uint32 invalid;
+        double seconds;                     //!< The time all levels took together
+    };
+
+    /*!
+     * @brief Constructor
+     *
+     * The solver is set up with a time limit of 10 seconds per level.
+     */
+    BatchSolver( void );
+
+    /*!
+     * @brief Destructor
+     */
+    ~BatchSolver( void );
+
+    /*!
+     * @brief Returns the solver every level is solved with a copy of
+     *
+     * Set the limits per level on it, e.g. getSolver().setTimeLimit( 30 ).
+     */
+    Solver& getSolver( void );
+
+    /*!
+     * @brief Sets the number of levels solved at the same time
+     *
+     * @param count The number of threads, or 0 to use one thread per
+     * hardware thread. The default is 0
+     */
+    void setThreadCount( Uint32 count );
+
+    /*!
+     * @brief Returns the number of levels solved at the same time, 0 meaning one per hardware thread
+     */
+    Uint32 getThreadCount( void ) const;
+
+    /*!
+     * @brief Solves every level and attaches the solutions found
+     *
+     * Levels are validated first if they aren't yet, and searched from their
+     * current position, which is also the position saved to collection files.
+     * A solution found replaces the "Solution" meta data of the level. Blocks
+     * until all levels are done.
+     *
+     * @param levels The levels to solve
+     */
+    void solve( std::vector<Level*>& levels );
+
+    /*!
+     * @brief Returns the outcome of the last call to solve
+     */
+    const Report& getReport( void ) const;
+
+    /*!
+     * @brief Streams the outcome of the last call to solve as a table, one row per level followed by the totals
+     *
+     * @param stream The output stream object to stream to
+     */
+    void streamReport( std::ostream& stream ) const;
+
+private:
+
+    Solver m_Solver;
+    Report m_Report;
+    Uint32 m_ThreadCount;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_BATCH_SOLVER_HPP__
@@ -0,0 +1,193 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Bitfield
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_BITFIELD_HPP__
+#define __CHOCOBUN_CORE_BITFIELD_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+
+#include <vector>
+
+namespace Chocobun {
+
+/*!
+ * @brief A dynamically sized set of bits packed into 64-bit words
+ *
+ * Used to store per-tile flags (such as box and goal positions) so whole
+ * board operations only need to touch one word per 64 tiles. All bit
+ * operations are inlined, because they sit on the hot path of every move.
+ */
+class Bitfield
+{
+public:
+
+    /*!
+     * @brief Default constructor, creates an empty bitfield
+     */
+    Bitfield( void ) {}
+
+    /*!
+     * @brief Constructs a bitfield with all bits cleared
+     *
+     * @param size The number of bits to hold
+     */
+    explicit Bitfield( Uint32 size ) : m_Words( (size+63) / 64, 0 ) {}
+
+    /*!
+     * @brief Resizes the bitfield and clears all bits
+     *
+     * @param size The number of bits to hold
+     */
+    void reset( Uint32 size ) { m_Words.assign( (size+63) / 64, 0 ); }
+
+    /*!
+     * @brief Returns true if the bit at the given index is set
+     */
+    bool test( Uint32 index ) const { return (m_Words[index >> 6] >> (index & 63)) & 1; }
+
+    /*!
+     * @brief Sets the bit at the given index
+     */
+    void set( Uint32 index ) { m_Words[index >> 6] |= Uint64(1) << (index & 63); }
+
+    /*!
+     * @brief Clears the bit at the given index
+     */
+    void clear( Uint32 index ) { m_Words[index >> 6] &= ~(Uint64(1) << (index & 63)); }
+
+    /*!
+     * @brief Clears one bit and sets another
+     *
+     * This is what moving a box boils down to.
+     */
+    void move( Uint32 from, Uint32 to ) { this->clear( from ); this->set( to ); }
+
+    /*!
+     * @brief Returns true if every bit set in this bitfield is also set in the other
+     *
+     * @note Both bitfields must have the same size
+     */
+    bool isSubsetOf( const Bitfield& other ) const
+    {
+        for( Uint32 i = 0; i != m_Words.size(); ++i )
+            if( m_Words[i] & ~other.m_Words[i] )
+                return false;
+        return true;
+    }
+
+    /*!
+     * @brief Counts the number of bits set
+     */
+    Uint32 count( void ) const
+    {
+        Uint32 total = 0;
+        for( Uint32 i = 0; i != m_Words.size(); ++i )
+            total += popCount( m_Words[i] );
+        return total;
+    }
+
+    /*!
+     * @brief Counts the number of bits set in both this and the other bitfield
+     *
+     * @note Both bitfields must have the same size
+     */
+    Uint32 countCommon( const Bitfield& other ) const
+    {
+        Uint32 total = 0;
+        for( Uint32 i = 0; i != m_Words.size(); ++i )
+            total += popCount( m_Words[i] & other.m_Words[i] );
+        return total;
+    }
+
+    /*!
+     * @brief Finds the next set bit
+     *
+     * @param index The index to start searching from (inclusive)
+     * @return The index of the next set bit, or getWordCount()*64 if there is none
+     */
+    Uint32 findNext( Uint32 index ) const
+    {
+        Uint32 wordIndex = index >> 6;
+        if( wordIndex >= m_Words.size() ) return m_Words.size() * 64;
+        Uint64 word = m_Words[wordIndex] & (~Uint64(0) << (index & 63));
+        while( !word )
+        {
+            if( ++wordIndex == m_Words.size() ) return m_Words.size() * 64;
+            word = m_Words[wordIndex];
+        }
+        return (wordIndex << 6) + countTrailingZeros( word );
+    }
+
+    /*!
+     * @brief Returns the number of 64-bit words used to store the bits
+     */
+    Uint32 getWordCount( void ) const { return m_Words.size(); }
+
+    /*!
+     * @brief Gives direct access to the underlying words
+     */
+    const Uint64* getWords( void ) const { return m_Words.empty() ? 0 : &m_Words[0]; }
+
+    bool operator==( const Bitfield& other ) const { return m_Words == other.m_Words; }
+    bool operator!=( const Bitfield& other ) const { return m_Words != other.m_Words; }
+
+    /*!
+     * @brief Counts the bits set in a single word
+     */
+    static Uint32 popCount( Uint64 word )
+    {
+#if defined(__GNUC__)
+        return __builtin_popcountll( word );
+#else
+        word = word - ((word >> 1) & 0x5555555555555555ULL);
+        word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+        word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        return static_cast<Uint32>( (word * 0x0101010101010101ULL) >> 56 );
+#endif
+    }
+
+    /*!
+     * @brief Returns the index of the lowest bit set in a word
+     *
+     * @note The word must not be 0
+     */
+    static Uint32 countTrailingZeros( Uint64 word )
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll( word );
+#else
+        Uint32 count = 0;
+        while( !(word & 1) ) { word >>= 1; ++count; }
+        return count;
+#endif
+    }
+
+private:
+
+    std::vector<Uint64> m_Words;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_BITFIELD_HPP__
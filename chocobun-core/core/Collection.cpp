@@ -23,10 +23,12 @@
 // include files
 
 #include <core/Collection.hpp>
+#include <core/BatchSolver.hpp>
 #include <core/CollectionParser.hpp>
 #include <core/Exception.hpp>
 
 #include <iostream>
+#include <algorithm>
 #include <core/Level.hpp>
 
 namespace Chocobun {
@@ -118,6 +120,14 @@ bool Collection::setActiveLevel( const std::string& levelName )
     {
         if( (*it)->getLevelName().compare( levelName ) == 0 )
         {
+
+            // move listeners over to the new active level
+            for( std::vector<LevelListener*>::iterator listener = m_Listeners.begin(); listener != m_Listeners.end(); ++listener )
+            {
+                if( m_ActiveLevel ) m_ActiveLevel->removeListener( *listener );
+                (*it)->addListener( *listener );
+            }
+
             m_ActiveLevel = (*it);
             return true;
         }
@@ -202,6 +212,41 @@ void Collection::moveRight( void )
     m_ActiveLevel->moveRight();
 }
 
+// --------------------------------------------------------------
+Uint32 Collection::applyMoves( const char* moves, size_t count )
+{
+    if( !m_ActiveLevel ) return 0;
+    return m_ActiveLevel->applyMoves( moves, count );
+}
+
+// --------------------------------------------------------------
+bool Collection::moveTo( Uint32 x, Uint32 y )
+{
+    if( !m_ActiveLevel ) return false;
+    return m_ActiveLevel->moveTo( x, y );
+}
+
+// --------------------------------------------------------------
+bool Collection::isDeadSquare( Uint32 x, Uint32 y ) const
+{
+    if( !m_ActiveLevel ) return false;
+    return m_ActiveLevel->isDeadSquare( x, y );
+}
+
+// --------------------------------------------------------------
+Solver::Result Collection::solve( Solver& solver ) const
+{
+    if( !m_ActiveLevel ) throw Exception( "[Collection::solve] Attempt to solve without first setting an active level" );
+    return solver.solve( *m_ActiveLevel );
+}
+
+// --------------------------------------------------------------
+void Collection::solveAll( BatchSolver& batchSolver )
+{
+    if( !m_IsInitialised ) throw Exception( "[Collection::solveAll] Attempt to solve before initialising the collection" );
+    batchSolver.solve( m_Levels );
+}
+
 // --------------------------------------------------------------
 void Collection::undo( void )
 {
@@ -216,4 +261,56 @@ void Collection::redo( void )
     m_ActiveLevel->redo();
 }
 
+// --------------------------------------------------------------
+void Collection::reset( void )
+{
+    if( !m_ActiveLevel ) return;
+    m_ActiveLevel->reset();
+}
+
+// --------------------------------------------------------------
+void Collection::seekToMove( Uint32 move )
+{
+    if( !m_ActiveLevel ) return;
+    m_ActiveLevel->seekToMove( move );
+}
+
+// --------------------------------------------------------------
+Uint32 Collection::getMoveCount( void ) const
+{
+    if( !m_ActiveLevel ) return 0;
+    return m_ActiveLevel->getMoveCount();
+}
+
+// --------------------------------------------------------------
+Uint32 Collection::getHistorySize( void ) const
+{
+    if( !m_ActiveLevel ) return 0;
+    return m_ActiveLevel->getHistorySize();
+}
+
+// --------------------------------------------------------------
+bool Collection::isSolved( void ) const
+{
+    if( !m_ActiveLevel ) return false;
+    return m_ActiveLevel->isSolved();
+}
+
+// --------------------------------------------------------------
+void Collection::addListener( LevelListener* listener )
+{
+    if( std::find( m_Listeners.begin(), m_Listeners.end(), listener ) != m_Listeners.end() ) return;
+    m_Listeners.push_back( listener );
+    if( m_ActiveLevel ) m_ActiveLevel->addListener( listener );
+}
+
+// --------------------------------------------------------------
+void Collection::removeListener( LevelListener* listener )
+{
+    std::vector<LevelListener*>::iterator it = std::find( m_Listeners.begin(), m_Listeners.end(), listener );
+    if( it == m_Listeners.end() ) return;
+    m_Listeners.erase( it );
+    if( m_ActiveLevel ) m_ActiveLevel->removeListener( listener );
+}
+
 } // namespace Chocobun
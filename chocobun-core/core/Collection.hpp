@@ -26,6 +26,7 @@
 // include files
 
 #include <core/Export.hpp>
+#include <core/Solver.hpp>
 
 #include <vector>
 #include <string>
@@ -35,7 +36,9 @@ namespace Chocobun {
 // --------------------------------------------------------------
 // forward declarations
 
+class BatchSolver;
 class Level;
+class LevelListener;
 
 /*!
  * @brief Holds a collection of levels which can be read from a file
@@ -276,6 +279,71 @@ public:
      */
     void moveRight( void );
 
+    /*!
+     * @brief Applies a sequence of moves in LURD notation to the active level
+     *
+     * This is a lot faster than calling moveUp, moveDown, etc. for every
+     * single move, because the active level is only looked up once.
+     * Both lower and upper case letters are accepted. Applying stops at
+     * the first move that is blocked or not a valid move character.
+     *
+     * @param moves The moves to apply
+     * @param count The number of characters in moves
+     * @return The number of moves applied. If this is less than count, the
+     * move at that index is the first illegal move.
+     */
+    Uint32 applyMoves( const char* moves, size_t count );
+
+    /*!
+     * @brief Walks the player of the active level to a tile along the shortest path
+     *
+     * No boxes are pushed on the way. The walk is recorded like normal moves.
+     *
+     * @param x The X coordinate of the target tile (0-based, like getTileData)
+     * @param y The Y coordinate of the target tile (0-based, like getTileData)
+     * @return True if the player was moved to the target, false if it can't
+     * be reached or there is no active level
+     */
+    bool moveTo( Uint32 x, Uint32 y );
+
+    /*!
+     * @brief Returns true if a box on a tile of the active level can never be pushed to a goal
+     *
+     * @see Level::isDeadSquare
+     * @param x The X coordinate of the tile (0-based, like getTileData)
+     * @param y The Y coordinate of the tile (0-based, like getTileData)
+     * @return True if the tile is dead, false if it isn't or there is no active level
+     */
+    bool isDeadSquare( Uint32 x, Uint32 y ) const;
+
+    /*!
+     * @brief Searches for a solution of the active level from its current position
+     *
+     * The active level isn't changed. The solution and statistics of the
+     * search can be retrieved from the solver afterwards.
+     *
+     * @exception Chocobun::Exception If there is no active level or it hasn't been validated
+     *
+     * @param solver The solver to search with
+     * @return The outcome of the search
+     */
+    Solver::Result solve( Solver& solver ) const;
+
+    /*!
+     * @brief Solves every level of the collection at the same time
+     *
+     * Levels are solved from their current position on a pool of threads
+     * (see BatchSolver). Solutions found are attached to the levels as
+     * "Solution" meta data, so they are written to the file together with
+     * the levels by deinitialise. The outcome of every level can be
+     * retrieved from the batch solver afterwards.
+     *
+     * @exception Chocobun::Exception If the collection hasn't been initialised
+     *
+     * @param batchSolver The batch solver to solve with
+     */
+    void solveAll( BatchSolver& batchSolver );
+
     /*!
      * @brief Undoes a move in the active level if any
      */
@@ -291,12 +359,64 @@ public:
      */
     void reset( void );
 
+    /*!
+     * @brief Jumps to any move in the undo/redo history of the active level
+     *
+     * This restores the nearest history snapshot and replays the remaining
+     * moves, so long sessions can be scrubbed through quickly.
+     *
+     * @param move The number of moves from the start of the level
+     */
+    void seekToMove( Uint32 move );
+
+    /*!
+     * @brief Returns the number of moves made to reach the current state of the active level
+     */
+    Uint32 getMoveCount( void ) const;
+
+    /*!
+     * @brief Returns the number of moves recorded for the active level, including moves that can be redone
+     */
+    Uint32 getHistorySize( void ) const;
+
+    /*!
+     * @brief Checks if the active level is solved
+     *
+     * This is maintained incrementally while moving, so it is cheap enough
+     * to call after every move.
+     *
+     * @return True if every box of the active level is on a goal, false if
+     * otherwise or if there is no active level
+     */
+    bool isSolved( void ) const;
+
+    /*!
+     * @brief Registers a listener to receive events from the active level
+     *
+     * The listener stays registered when a different level is selected
+     * as active.
+     *
+     * @note The listener is not owned by the collection and must be removed
+     * again before it is destroyed.
+     *
+     * @param listener The listener to register
+     */
+    void addListener( LevelListener* listener );
+
+    /*!
+     * @brief Unregisters a listener
+     *
+     * @param listener The listener to remove
+     */
+    void removeListener( LevelListener* listener );
+
 private:
 
     std::string m_FileName;
     std::string m_CollectionName;
     std::vector<Level*> m_Levels;
     Level* m_ActiveLevel;
+    std::vector<LevelListener*> m_Listeners;
     bool m_EnableCompression;
     bool m_IsInitialised;
 };
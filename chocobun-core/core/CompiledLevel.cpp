@@ -0,0 +1,413 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Compiled level
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/CompiledLevel.hpp>
+
+#include <algorithm>
+
+namespace Chocobun {
+
+const Uint32 CompiledLevel::NO_CELL;
+const Uint16 CompiledLevel::NO_DISTANCE;
+const Uint32 CompiledLevel::NO_ROOM;
+const Uint32 CompiledLevel::MAX_GOAL_ROOM_CELLS;
+const Uint32 CompiledLevel::MAX_FREEZE_BOXES;
+
+namespace {
+
+const Uint32 NO_STATE = 0xFFFFFFFF;
+
+// --------------------------------------------------------------
+// a part of the level split off by removing a single cell, as found
+// by the depth-first search of CompiledLevel::findGoalRooms. The
+// cells of the part are a range of the preorder
+struct RoomCandidate
+{
+    Uint32 entrance;
+    Uint32 first;
+    Uint32 size;
+    Uint32 goalCount;
+
+    bool operator<( const RoomCandidate& other ) const { return size > other.size; }
+    bool contains( const RoomCandidate& other ) const
+    {
+        return other.first >= first && other.first + other.size <= first + size;
+    }
+};
+
+// --------------------------------------------------------------
+// breadth-first search over the positions of a single box pushed
+// from the entrance into a goal room. States are a box cell times
+// the side of the box the player is on
+class RoomSearch
+{
+public:
+
+    RoomSearch( const CompiledLevel& level ) :
+        m_Level( level ),
+        m_Parents( level.getCellCount() * 4 ),
+        m_Reached( level.getCellCount() ),
+        m_Marks( level.getCellCount(), 0 ),
+        m_Mark( 0 )
+    {}
+
+    // the player may walk inside the room, on the entrance and on the cell
+    // it pushed the box onto the entrance from. Filled goals hold boxes
+    void run( Uint32 room, Uint32 entrance, Uint32 direction, const std::vector<bool>& isFilled )
+    {
+        std::fill( m_Parents.begin(), m_Parents.end(), NO_STATE );
+        std::fill( m_Reached.begin(), m_Reached.end(), NO_STATE );
+        Uint32 side = m_Level.getNeighbour( entrance, direction ^ 1 );
+        std::vector<Uint32> queue;
+        Uint32 start = entrance*4 + (direction ^ 1);
+        m_Parents[start] = start;
+        m_Reached[entrance] = start;
+        queue.push_back( start );
+        for( Uint32 head = 0; head != queue.size(); ++head )
+        {
+            Uint32 box = queue[head] / 4;
+            this->markPlayer( room, entrance, side, isFilled, box, m_Level.getNeighbour( box, queue[head] % 4 ) );
+            for( Uint32 push = 0; push != 4; ++push )
+            {
+                Uint32 from = m_Level.getNeighbour( box, push ^ 1 );
+                Uint32 to = m_Level.getNeighbour( box, push );
+                if( from == CompiledLevel::NO_CELL || to == CompiledLevel::NO_CELL ) continue;
+                if( m_Marks[from] != m_Mark ) continue;
+                if( m_Level.getGoalRoom( to ) != room || isFilled[to] || m_Level.isDead( to ) ) continue;
+                Uint32 state = to*4 + (push ^ 1);
+                if( m_Parents[state] != NO_STATE ) continue;
+                m_Parents[state] = queue[head];
+                if( m_Reached[to] == NO_STATE ) m_Reached[to] = state;
+                queue.push_back( state );
+            }
+        }
+    }
+
+    bool isReached( Uint32 cell ) const { return m_Reached[cell] != NO_STATE; }
+
+    // the directions of the pushes to a reached cell, in order
+    void getRoute( Uint32 cell, std::vector<Uint8>& route ) const
+    {
+        route.clear();
+        for( Uint32 state = m_Reached[cell]; m_Parents[state] != state; state = m_Parents[state] )
+            route.push_back( static_cast<Uint8>( (state % 4) ^ 1 ) );
+        std::reverse( route.begin(), route.end() );
+    }
+
+private:
+
+    void markPlayer( Uint32 room, Uint32 entrance, Uint32 side, const std::vector<bool>& isFilled, Uint32 box, Uint32 player )
+    {
+        ++m_Mark;
+        std::vector<Uint32> stack( 1, player );
+        m_Marks[player] = m_Mark;
+        while( !stack.empty() )
+        {
+            Uint32 cell = stack.back();
+            stack.pop_back();
+            for( Uint32 direction = 0; direction != 4; ++direction )
+            {
+                Uint32 next = m_Level.getNeighbour( cell, direction );
+                if( next == CompiledLevel::NO_CELL || next == box || m_Marks[next] == m_Mark ) continue;
+                if( next != entrance && next != side && (m_Level.getGoalRoom( next ) != room || isFilled[next]) ) continue;
+                m_Marks[next] = m_Mark;
+                stack.push_back( next );
+            }
+        }
+    }
+
+    const CompiledLevel& m_Level;
+    std::vector<Uint32> m_Parents;
+    std::vector<Uint32> m_Reached;
+    std::vector<Uint32> m_Marks;
+    Uint32 m_Mark;
+};
+
+} // namespace
+
+// --------------------------------------------------------------
+CompiledLevel::CompiledLevel( void ) :
+    m_Stride( 2 )
+{
+}
+
+// --------------------------------------------------------------
+CompiledLevel::~CompiledLevel( void )
+{
+}
+
+// --------------------------------------------------------------
+void CompiledLevel::compile( const std::vector<char>& tiles, const Bitfield& goals, Uint32 stride, Uint32 playerIndex )
+{
+    this->clear();
+    m_Stride = stride;
+    Int32 offset[4] = { -static_cast<Int32>(stride), static_cast<Int32>(stride), -1, 1 };
+
+    // find all tiles the player can reach. The level is surrounded by walls,
+    // so the search never leaves the tile array
+    std::vector<bool> isReachable( tiles.size(), false );
+    std::vector<Uint32> stack( 1, playerIndex );
+    isReachable[playerIndex] = true;
+    while( !stack.empty() )
+    {
+        Uint32 index = stack.back();
+        stack.pop_back();
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 next = index + offset[direction];
+            if( isReachable[next] || tiles[next] == '#' ) continue;
+            isReachable[next] = true;
+            stack.push_back( next );
+        }
+    }
+
+    // number the reachable tiles in row-major order
+    m_TileToCell.assign( tiles.size(), NO_CELL );
+    for( Uint32 index = 0; index != tiles.size(); ++index )
+    {
+        if( !isReachable[index] ) continue;
+        m_TileToCell[index] = static_cast<Uint32>( m_CellToTile.size() );
+        m_CellToTile.push_back( index );
+    }
+
+    // link neighbours and set flags
+    Uint32 cellCount = this->getCellCount();
+    m_Neighbours.resize( cellCount * 4 );
+    m_Flags.assign( cellCount, 0 );
+    for( Uint32 cell = 0; cell != cellCount; ++cell )
+    {
+        Uint32 index = m_CellToTile[cell];
+        for( Uint32 direction = 0; direction != 4; ++direction )
+            m_Neighbours[cell*4 + direction] = m_TileToCell[index + offset[direction]];
+
+        if( goals.test(index) )
+        {
+            m_Flags[cell] |= CELL_GOAL;
+            m_GoalCells.push_back( cell );
+        }
+        if( (m_Neighbours[cell*4 + 0] == NO_CELL && m_Neighbours[cell*4 + 1] == NO_CELL) ||
+            (m_Neighbours[cell*4 + 2] == NO_CELL && m_Neighbours[cell*4 + 3] == NO_CELL) )
+            m_Flags[cell] |= CELL_TUNNEL;
+    }
+
+    this->computePushDistances();
+
+    // a box on a cell which can't be pulled to from any goal can never be
+    // pushed onto one. This covers corners as well as walls without goals
+    for( Uint32 cell = 0; cell != cellCount; ++cell )
+        if( m_MinPushDistances[cell] == NO_DISTANCE )
+            m_Flags[cell] |= CELL_DEAD;
+
+    this->findGoalRooms( m_TileToCell[playerIndex] );
+}
+
+// --------------------------------------------------------------
+void CompiledLevel::computePushDistances( void )
+{
+    Uint32 cellCount = this->getCellCount();
+    m_PushDistances.assign( m_GoalCells.size() * cellCount, NO_DISTANCE );
+    m_MinPushDistances.assign( cellCount, NO_DISTANCE );
+
+    // breadth-first search pulling a box away from each goal. A box on cell
+    // "to" can be pulled to "from" if the player has room to step back
+    std::vector<Uint32> queue( cellCount );
+    for( Uint32 goal = 0; goal != m_GoalCells.size(); ++goal )
+    {
+        Uint16* distance = &m_PushDistances[goal * cellCount];
+        Uint32 head = 0, tail = 0;
+        queue[tail++] = m_GoalCells[goal];
+        distance[m_GoalCells[goal]] = 0;
+        while( head != tail )
+        {
+            Uint32 to = queue[head++];
+            for( Uint32 direction = 0; direction != 4; ++direction )
+            {
+                Uint32 from = this->getNeighbour( to, direction );
+                if( from == NO_CELL || distance[from] != NO_DISTANCE ) continue;
+                if( this->getNeighbour( from, direction ) == NO_CELL ) continue;
+                distance[from] = distance[to] + 1;
+                queue[tail++] = from;
+            }
+        }
+        for( Uint32 cell = 0; cell != cellCount; ++cell )
+            if( distance[cell] < m_MinPushDistances[cell] )
+                m_MinPushDistances[cell] = distance[cell];
+    }
+}
+
+// --------------------------------------------------------------
+void CompiledLevel::findGoalRooms( Uint32 start )
+{
+    Uint32 cellCount = this->getCellCount();
+    m_CellGoalRooms.assign( cellCount, NO_ROOM );
+
+    // depth-first search from the player. The subtree of a cell is split off
+    // by removing its parent if no cell of the subtree links to a cell
+    // visited before the parent (Tarjan's articulation points)
+    std::vector<Uint32> order( cellCount, NO_CELL );
+    std::vector<Uint32> low( cellCount );
+    std::vector<Uint32> size( cellCount, 1 );
+    std::vector<Uint32> preorder;
+    std::vector<Uint32> stack( 1, start );
+    std::vector<Uint32> nextDirection( cellCount, 0 );
+    std::vector<RoomCandidate> candidates;
+    order[start] = low[start] = 0;
+    preorder.push_back( start );
+    while( !stack.empty() )
+    {
+        Uint32 cell = stack.back();
+        if( nextDirection[cell] == 4 )
+        {
+            stack.pop_back();
+            if( stack.empty() ) break;
+            Uint32 parent = stack.back();
+            low[parent] = std::min( low[parent], low[cell] );
+            size[parent] += size[cell];
+            if( low[cell] >= order[parent] )
+            {
+                RoomCandidate candidate = { parent, order[cell], size[cell], 0 };
+                candidates.push_back( candidate );
+            }
+            continue;
+        }
+        Uint32 next = this->getNeighbour( cell, nextDirection[cell]++ );
+        if( next == NO_CELL ) continue;
+        if( order[next] == NO_CELL )
+        {
+            order[next] = low[next] = static_cast<Uint32>( preorder.size() );
+            preorder.push_back( next );
+            stack.push_back( next );
+        }else
+            low[cell] = std::min( low[cell], order[next] );
+    }
+
+    // count the goals of every candidate
+    std::vector<Uint32> goalCounts( cellCount + 1, 0 );
+    for( Uint32 i = 0; i != preorder.size(); ++i )
+        goalCounts[i+1] = goalCounts[i] + ( this->isGoal( preorder[i] ) ? 1 : 0 );
+    for( std::vector<RoomCandidate>::iterator it = candidates.begin(); it != candidates.end(); ++it )
+        it->goalCount = goalCounts[it->first + it->size] - goalCounts[it->first];
+
+    // largest candidates first, skipping those inside a room already found
+    // and those with a smaller candidate inside holding the same goals
+    std::sort( candidates.begin(), candidates.end() );
+    std::vector<RoomCandidate> rooms;
+    for( Uint32 i = 0; i != candidates.size(); ++i )
+    {
+        const RoomCandidate& candidate = candidates[i];
+        if( candidate.goalCount == 0 || candidate.size > MAX_GOAL_ROOM_CELLS ) continue;
+        bool isSkipped = false;
+        for( Uint32 j = 0; j != rooms.size() && !isSkipped; ++j )
+            isSkipped = rooms[j].contains( candidate );
+        for( Uint32 j = i+1; j != candidates.size() && !isSkipped; ++j )
+            isSkipped = candidate.contains( candidates[j] ) && candidates[j].goalCount == candidate.goalCount;
+        if( isSkipped ) continue;
+        rooms.push_back( candidate );
+    }
+
+    for( Uint32 room = 0; room != rooms.size(); ++room )
+    {
+        GoalRoom goalRoom;
+        goalRoom.entrance = rooms[room].entrance;
+        m_GoalRooms.push_back( goalRoom );
+        for( Uint32 i = rooms[room].first; i != rooms[room].first + rooms[room].size; ++i )
+            m_CellGoalRooms[preorder[i]] = room;
+        this->fillGoalRoom( room );
+    }
+}
+
+// --------------------------------------------------------------
+void CompiledLevel::fillGoalRoom( Uint32 room )
+{
+    GoalRoom& goalRoom = m_GoalRooms[room];
+    std::vector<Uint32> remaining;
+    for( Uint32 goal = 0; goal != m_GoalCells.size(); ++goal )
+        if( m_CellGoalRooms[m_GoalCells[goal]] == room )
+            remaining.push_back( goal );
+
+    // boxes can be pushed onto the entrance from any side outside the room
+    bool isEntryDirection[4];
+    for( Uint32 direction = 0; direction != 4; ++direction )
+    {
+        Uint32 side = this->getNeighbour( goalRoom.entrance, direction ^ 1 );
+        isEntryDirection[direction] = ( side != NO_CELL && m_CellGoalRooms[side] != room );
+    }
+
+    RoomSearch search( *this );
+    std::vector<bool> isFilled( this->getCellCount(), false );
+    std::vector< std::vector<Uint8> > routes( 4 );
+    while( !remaining.empty() )
+    {
+        // find the deepest goal reachable from any side
+        Uint32 best = 0xFFFFFFFF;
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            routes[direction].clear();
+            if( !isEntryDirection[direction] ) continue;
+            search.run( room, goalRoom.entrance, direction, isFilled );
+            for( Uint32 i = 0; i != remaining.size(); ++i )
+                if( search.isReached( m_GoalCells[remaining[i]] ) &&
+                    (best == 0xFFFFFFFF || this->getPushDistance( remaining[i], goalRoom.entrance ) > this->getPushDistance( remaining[best], goalRoom.entrance )) )
+                    best = i;
+        }
+        if( best == 0xFFFFFFFF ) break;
+
+        Uint32 cell = m_GoalCells[remaining[best]];
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            if( !isEntryDirection[direction] ) continue;
+            search.run( room, goalRoom.entrance, direction, isFilled );
+            if( search.isReached( cell ) )
+                search.getRoute( cell, routes[direction] );
+        }
+        goalRoom.goals.push_back( cell );
+        goalRoom.routes.insert( goalRoom.routes.end(), routes.begin(), routes.end() );
+        isFilled[cell] = true;
+        remaining.erase( remaining.begin() + best );
+    }
+}
+
+// --------------------------------------------------------------
+void CompiledLevel::clear( void )
+{
+    m_Neighbours.clear();
+    m_Flags.clear();
+    m_CellToTile.clear();
+    m_TileToCell.clear();
+    m_GoalCells.clear();
+    m_PushDistances.clear();
+    m_MinPushDistances.clear();
+    m_GoalRooms.clear();
+    m_CellGoalRooms.clear();
+}
+
+// --------------------------------------------------------------
+Uint32 CompiledLevel::getCell( Uint32 x, Uint32 y ) const
+{
+    Uint32 index = (y+1)*m_Stride + x+1;
+    if( x+2 >= m_Stride || index >= m_TileToCell.size() ) return NO_CELL;
+    return m_TileToCell[index];
+}
+
+} // namespace Chocobun
@@ -0,0 +1,397 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Compiled level
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_COMPILED_LEVEL_HPP__
+#define __CHOCOBUN_CORE_COMPILED_LEVEL_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Export.hpp>
+#include <core/Bitfield.hpp>
+
+#include <vector>
+
+namespace Chocobun {
+
+/*!
+ * @brief A level reduced to a graph of the cells the player can walk on
+ *
+ * Analysis code (path finding, deadlock detection, solvers) doesn't need
+ * walls or the space outside of a level. Compiling a level numbers only the
+ * floor tiles reachable from the player (ignoring boxes) with small, dense
+ * cell indices, and precomputes the neighbours and properties of every cell.
+ * Algorithms can then index plain arrays by cell instead of looking at tile
+ * characters.
+ *
+ * Cells are numbered in row-major order, so cells close to each other on
+ * the board are mostly close in memory too.
+ *
+ * Directions are the same as those of Level moves: 0 is up, 1 is down,
+ * 2 is left and 3 is right. Opposite directions only differ in their lowest
+ * bit (direction ^ 1).
+ *
+ * Levels are compiled by Level::validateLevel, see Level::getCompiledLevel.
+ */
+class CHOCOBUN_CORE_API CompiledLevel
+{
+public:
+
+    /*!
+     * @brief Returned instead of a cell where there is none (walls, outside)
+     */
+    static const Uint32 NO_CELL = 0xFFFFFFFF;
+
+    /*!
+     * @brief Returned as push distance if a box can't be pushed to a goal
+     */
+    static const Uint16 NO_DISTANCE = 0xFFFF;
+
+    /*!
+     * @brief Returned by getGoalRoom for cells outside of goal rooms
+     */
+    static const Uint32 NO_ROOM = 0xFFFFFFFF;
+
+    /*!
+     * @brief The largest number of cells a goal room may have
+     */
+    static const Uint32 MAX_GOAL_ROOM_CELLS = 64;
+
+    /*!
+     * @brief An area with goals which can only be entered through a single cell
+     *
+     * Boxes entering a goal room are pushed to the goals in a fixed order,
+     * so a box pushed onto the entrance while the room holds boxes on the
+     * first goals of the order (and no others) can be pushed straight to
+     * the next goal along a precomputed route.
+     */
+    struct GoalRoom
+    {
+        /*!
+         * The cell the room is entered through. It isn't part of the room
+         */
+        Uint32 entrance;
+
+        /*!
+         * The goals of the room in the order they are filled. Goals which
+         * can't be filled this way once the others are aren't listed
+         */
+        std::vector<Uint32> goals;
+
+        /*!
+         * The directions of the pushes taking a box from the entrance to
+         * goals[i] while goals[0] to goals[i-1] hold boxes, for a box pushed
+         * onto the entrance in direction d: routes[i*4 + d]. Empty if there
+         * is no such route
+         */
+        std::vector< std::vector<Uint8> > routes;
+    };
+
+    /*!
+     * @brief Properties of a cell
+     */
+    enum CellFlag
+    {
+        CELL_GOAL = 1,      //!< The cell is a goal
+        CELL_DEAD = 2,      //!< A box on this cell can never reach a goal, see isDead
+        CELL_TUNNEL = 4     //!< The cell has walls on two opposite sides
+    };
+
+    /*!
+     * @brief Constructor
+     *
+     * Constructs an empty graph without any cells.
+     */
+    CompiledLevel( void );
+
+    /*!
+     * @brief Destructor
+     */
+    ~CompiledLevel( void );
+
+    /*!
+     * @brief Builds the cell graph of a level
+     *
+     * @param tiles The static layer of the level, row-major with a border of
+     * walls around it. Tiles are either '#' (wall) or floor
+     * @param goals The goal tiles
+     * @param stride The number of tiles per row, including the border
+     * @param playerIndex The tile the player starts on
+     */
+    void compile( const std::vector<char>& tiles, const Bitfield& goals, Uint32 stride, Uint32 playerIndex );
+
+    /*!
+     * @brief Removes all cells
+     */
+    void clear( void );
+
+    /*!
+     * @brief Returns the number of cells
+     */
+    Uint32 getCellCount( void ) const { return static_cast<Uint32>( m_CellToTile.size() ); }
+
+    /*!
+     * @brief Returns the neighbour of a cell in a direction, or NO_CELL if it is blocked by a wall
+     */
+    Uint32 getNeighbour( Uint32 cell, Uint32 direction ) const { return m_Neighbours[cell*4 + direction]; }
+
+    /*!
+     * @brief Returns the CellFlag values set for a cell
+     */
+    Uint8 getFlags( Uint32 cell ) const { return m_Flags[cell]; }
+
+    /*!
+     * @brief Returns true if the cell is a goal
+     */
+    bool isGoal( Uint32 cell ) const { return (m_Flags[cell] & CELL_GOAL) != 0; }
+
+    /*!
+     * @brief Returns true if a box on the cell can never reach a goal
+     *
+     * Dead cells are found by pulling a box away from every goal: cells the
+     * box can't be pulled to are dead, no matter where the other boxes are.
+     * Goals are never dead.
+     */
+    bool isDead( Uint32 cell ) const { return (m_Flags[cell] & CELL_DEAD) != 0; }
+
+    /*!
+     * @brief Returns true if the cell has walls on two opposite sides
+     */
+    bool isTunnel( Uint32 cell ) const { return (m_Flags[cell] & CELL_TUNNEL) != 0; }
+
+    /*!
+     * @brief Returns true if the cell has walls on both sides when moving through it in a direction
+     */
+    bool isTunnel( Uint32 cell, Uint32 direction ) const
+    {
+        Uint32 axis = ( direction < 2 ? 2 : 0 );
+        return m_Neighbours[cell*4 + axis] == NO_CELL && m_Neighbours[cell*4 + axis + 1] == NO_CELL;
+    }
+
+    /*!
+     * @brief Returns the index of the goal room (see getGoalRooms) a cell belongs to, or NO_ROOM
+     */
+    Uint32 getGoalRoom( Uint32 cell ) const { return m_CellGoalRooms[cell]; }
+
+    /*!
+     * @brief Returns the goal rooms of the level
+     *
+     * Goal rooms are found through the cells which split the level in two
+     * when removed. Of the parts not holding the player, those with goals
+     * and at most MAX_GOAL_ROOM_CELLS cells are goal rooms, preferring the
+     * largest part among nested ones and the smallest part among nested
+     * ones with the same goals.
+     */
+    const std::vector<GoalRoom>& getGoalRooms( void ) const { return m_GoalRooms; }
+
+    /*!
+     * @brief Converts a tile index of the level into a cell, or NO_CELL if the tile isn't a cell
+     */
+    Uint32 getCell( Uint32 tileIndex ) const { return m_TileToCell[tileIndex]; }
+
+    /*!
+     * @brief Converts level coordinates (0-based) into a cell, or NO_CELL if the tile isn't a cell
+     */
+    Uint32 getCell( Uint32 x, Uint32 y ) const;
+
+    /*!
+     * @brief Converts a cell into a tile index of the level
+     */
+    Uint32 getTileIndex( Uint32 cell ) const { return m_CellToTile[cell]; }
+
+    /*!
+     * @brief Returns the X coordinate (0-based) of a cell
+     */
+    Uint32 getX( Uint32 cell ) const { return m_CellToTile[cell] % m_Stride - 1; }
+
+    /*!
+     * @brief Returns the Y coordinate (0-based) of a cell
+     */
+    Uint32 getY( Uint32 cell ) const { return m_CellToTile[cell] / m_Stride - 1; }
+
+    /*!
+     * @brief Returns all goal cells in ascending order
+     */
+    const std::vector<Uint32>& getGoalCells( void ) const { return m_GoalCells; }
+
+    /*!
+     * @brief Returns the number of pushes needed to move a box from a cell to a goal
+     *
+     * Other boxes are ignored and the player is assumed to be able to reach
+     * any side of the box, so this is a lower bound of the real number of
+     * pushes. It is computed by pulling a box away from every goal.
+     *
+     * @param goal The index of the goal in getGoalCells()
+     * @param cell The cell the box is on
+     * @return The number of pushes, or NO_DISTANCE if the goal can't be reached
+     */
+    Uint16 getPushDistance( Uint32 goal, Uint32 cell ) const { return m_PushDistances[goal*this->getCellCount() + cell]; }
+
+    /*!
+     * @brief Returns the number of pushes needed to move a box from a cell to the nearest goal
+     *
+     * @see getPushDistance
+     * @return The number of pushes, or NO_DISTANCE if no goal can be reached
+     */
+    Uint16 getMinPushDistance( Uint32 cell ) const { return m_MinPushDistances[cell]; }
+
+    /*!
+     * @brief Returns true if a box is frozen together with at least one box off goal
+     *
+     * A box is frozen if it is blocked both vertically and horizontally. It
+     * is blocked along an axis if there is a wall on either side, dead cells
+     * on both sides, or a frozen box on either side. Neighbouring boxes are
+     * checked recursively, treating the boxes being checked as walls.
+     *
+     * Only the neighbourhood of the box is looked at, and at most
+     * MAX_FREEZE_BOXES boxes are examined, so this is cheap enough to run
+     * after every push. If the limit is hit, the box is assumed not to be
+     * frozen, so a deadlock may be missed but is never reported wrongly.
+     *
+     * @param cell The cell of the box, usually the one just pushed
+     * @param hasBox Function object taking a cell and returning true if
+     * there is a box on it
+     */
+    template <class BoxTest>
+    bool isFreezeDeadlock( Uint32 cell, const BoxTest& hasBox ) const;
+
+    /*!
+     * @brief The maximum number of boxes examined by isFreezeDeadlock
+     */
+    static const Uint32 MAX_FREEZE_BOXES = 16;
+
+private:
+
+    // boxes being examined by isFreezeDeadlock
+    struct FreezeCheck
+    {
+        Uint32 cells[MAX_FREEZE_BOXES];
+        Uint32 count;
+        Uint32 examined;
+    };
+
+    /*!
+     * @brief Returns true if the box on a cell is frozen, see isFreezeDeadlock
+     *
+     * @param isOffGoal Set to true if the box or a box it is frozen by is off goal
+     */
+    template <class BoxTest>
+    bool isFrozen( Uint32 cell, const BoxTest& hasBox, FreezeCheck& check, bool& isOffGoal ) const;
+
+    /*!
+     * @brief Returns true if a box is blocked along an axis, see isFreezeDeadlock
+     *
+     * @param axis 0 for vertical, 2 for horizontal (the first direction of the axis)
+     */
+    template <class BoxTest>
+    bool isBlocked( Uint32 cell, Uint32 axis, const BoxTest& hasBox, FreezeCheck& check, bool& isOffGoal ) const;
+
+    /*!
+     * @brief Fills m_PushDistances and m_MinPushDistances
+     */
+    void computePushDistances( void );
+
+    /*!
+     * @brief Fills m_GoalRooms and m_CellGoalRooms
+     *
+     * @param start The cell of the player
+     */
+    void findGoalRooms( Uint32 start );
+
+    /*!
+     * @brief Finds the order the goals of a room are filled in, and the routes to them
+     *
+     * The deepest goal (by push distance from the entrance) a box can be
+     * pushed to is filled first.
+     */
+    void fillGoalRoom( Uint32 room );
+
+    // 4 entries per cell, one for each direction
+    std::vector<Uint32> m_Neighbours;
+    std::vector<Uint8> m_Flags;
+    std::vector<Uint32> m_CellToTile;
+    std::vector<Uint32> m_TileToCell;
+    std::vector<Uint32> m_GoalCells;
+
+    // one row of getCellCount() entries per goal
+    std::vector<Uint16> m_PushDistances;
+    std::vector<Uint16> m_MinPushDistances;
+    std::vector<GoalRoom> m_GoalRooms;
+    std::vector<Uint32> m_CellGoalRooms;
+    Uint32 m_Stride;
+};
+
+// --------------------------------------------------------------
+template <class BoxTest>
+bool CompiledLevel::isFreezeDeadlock( Uint32 cell, const BoxTest& hasBox ) const
+{
+    FreezeCheck check;
+    check.count = 0;
+    check.examined = 0;
+    bool isOffGoal = false;
+    return this->isFrozen( cell, hasBox, check, isOffGoal ) && isOffGoal;
+}
+
+// --------------------------------------------------------------
+template <class BoxTest>
+bool CompiledLevel::isFrozen( Uint32 cell, const BoxTest& hasBox, FreezeCheck& check, bool& isOffGoal ) const
+{
+    if( check.examined == MAX_FREEZE_BOXES ) return false;
+    ++check.examined;
+
+    // boxes examined further up are treated as walls while this one is
+    // checked. If it turns out not to be frozen, the boxes examined for it
+    // aren't walls after all
+    Uint32 count = check.count;
+    check.cells[check.count++] = cell;
+    bool isFrozenOffGoal = !this->isGoal( cell );
+    if( this->isBlocked( cell, 0, hasBox, check, isFrozenOffGoal ) &&
+        this->isBlocked( cell, 2, hasBox, check, isFrozenOffGoal ) )
+    {
+        isOffGoal = isOffGoal || isFrozenOffGoal;
+        return true;
+    }
+    check.count = count;
+    return false;
+}
+
+// --------------------------------------------------------------
+template <class BoxTest>
+bool CompiledLevel::isBlocked( Uint32 cell, Uint32 axis, const BoxTest& hasBox, FreezeCheck& check, bool& isOffGoal ) const
+{
+    Uint32 first = this->getNeighbour( cell, axis );
+    Uint32 second = this->getNeighbour( cell, axis+1 );
+    if( first == NO_CELL || second == NO_CELL ) return true;
+    if( this->isDead( first ) && this->isDead( second ) ) return true;
+
+    Uint32 sides[2] = { first, second };
+    for( Uint32 i = 0; i != 2; ++i )
+        for( Uint32 j = 0; j != check.count; ++j )
+            if( check.cells[j] == sides[i] ) return true;
+    for( Uint32 i = 0; i != 2; ++i )
+        if( hasBox( sides[i] ) && this->isFrozen( sides[i], hasBox, check, isOffGoal ) )
+            return true;
+    return false;
+}
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_COMPILED_LEVEL_HPP__
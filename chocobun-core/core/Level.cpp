@@ -23,21 +23,117 @@
 // include files
 
 #include <core/Level.hpp>
+#include <core/LevelListener.hpp>
+#include <core/PatternDatabase.hpp>
+#include <core/Zobrist.hpp>
 #include <core/Exception.hpp>
 
+#include <algorithm>
+#include <cassert>
+
 const std::string Chocobun::Level::validTiles = "#@+$*. _pPbB";
 
 namespace Chocobun {
-
+
+// maps LURD move characters to directions (in the order of Level::Direction),
+// all other characters map to -1
+static const struct MoveDirectionTable
+{
+    Int8 table[256];
+    MoveDirectionTable( void )
+    {
+        for( Uint32 i = 0; i != 256; ++i )
+            table[i] = -1;
+        const char* moves = "udlr";
+        for( Int8 direction = 0; direction != 4; ++direction )
+        {
+            table[static_cast<Uint8>(moves[direction])] = direction;
+            table[static_cast<Uint8>(moves[direction] - 32)] = direction;
+        }
+    }
+} moveDirections;
+
 // --------------------------------------------------------------
+Level::StaticData::StaticData( void ) :
+    sizeX( 0 ),
+    sizeY( 0 ),
+    stride( 2 ),
+    playerCount( 0 ),
+    boxCount( 0 )
+{
+}
+
+// --------------------------------------------------------------
 Level::Level( void ) :
-    m_IsLevelValid( false ),
-    m_UndoDataIndex( -1 ) // type is unsigned, but the wrap around is intended
+    m_StaticData( std::make_shared<StaticData>() ),
+    m_PathMark( 0 ),
+    m_PushMark( 0 ),
+    m_NormalisedPlayerIndex( 0 ),
+    m_NormalisedPlayerIndexIsDirty( true ),
+    m_FloodFillMark( 0 ),
+    m_TileBufferIsDirty( true ),
+    m_TileDataViewIsDirty( true ),
+    m_PatternDatabase( 0 ),
+    m_HistoryIndex( 0 ),
+    m_IsLevelValid( false )
 {
-    m_LevelArray.push_back( std::vector<char>(0) );
+    this->resizeTileBuffer( 0, 0 );
 }
 
 // --------------------------------------------------------------
+Level::Level( const std::shared_ptr<StaticData>& staticData, const LevelState& state ) :
+    m_StaticData( staticData ),
+    m_State( state ),
+    m_PathMark( 0 ),
+    m_PushMark( 0 ),
+    m_NormalisedPlayerIndex( 0 ),
+    m_NormalisedPlayerIndexIsDirty( true ),
+    m_FloodFillMark( 0 ),
+    m_TileBufferIsDirty( true ),
+    m_TileDataViewIsDirty( true ),
+    m_PatternDatabase( 0 ),
+    m_HistoryIndex( 0 ),
+    m_IsLevelValid( false )
+{
+}
+
+// --------------------------------------------------------------
+Level::Level( const Level& other ) :
+    m_StaticData( other.m_StaticData ),
+    m_State( other.m_State ),
+    m_History( other.m_History ),
+    m_PathMark( 0 ),
+    m_PushMark( 0 ),
+    m_NormalisedPlayerIndex( other.m_NormalisedPlayerIndex ),
+    m_NormalisedPlayerIndexIsDirty( other.m_NormalisedPlayerIndexIsDirty ),
+    m_FloodFillMark( 0 ),
+    m_TileBufferIsDirty( true ),
+    m_TileDataViewIsDirty( true ),
+    m_PatternDatabase( other.m_PatternDatabase ),
+    m_HistoryIndex( other.m_HistoryIndex ),
+    m_IsLevelValid( other.m_IsLevelValid )
+{
+}
+
+// --------------------------------------------------------------
+Level& Level::operator=( const Level& other )
+{
+    if( this == &other ) return *this;
+
+    m_StaticData = other.m_StaticData;
+    m_State = other.m_State;
+    m_History = other.m_History;
+    m_NormalisedPlayerIndex = other.m_NormalisedPlayerIndex;
+    m_NormalisedPlayerIndexIsDirty = other.m_NormalisedPlayerIndexIsDirty;
+    m_TileBufferIsDirty = true;
+    m_TileDataViewIsDirty = true;
+    m_PatternDatabase = other.m_PatternDatabase;
+    m_HistoryIndex = other.m_HistoryIndex;
+    m_IsLevelValid = other.m_IsLevelValid;
+    return *this;
+}
+
+// --------------------------------------------------------------
 Level::~Level( void )
 {
 }
@@ -45,16 +141,23 @@ Level::~Level( void )
 // --------------------------------------------------------------
 void Level::addMetaData( const std::string& key, const std::string& value )
 {
-    if( m_MetaData.find( key ) != m_MetaData.end() )
+    StaticData& data = this->getWritableStaticData();
+    if( data.metaData.find( key ) != data.metaData.end() )
         throw Exception( "[Level::addMetaData] meta data already exists" );
-    m_MetaData[key] = value;
+    data.metaData[key] = value;
+}
+
+// --------------------------------------------------------------
+void Level::setMetaData( const std::string& key, const std::string& value )
+{
+    this->getWritableStaticData().metaData[key] = value;
 }
 
 // --------------------------------------------------------------
 const std::string& Level::getMetaData( const std::string& key )
 {
-    std::map<std::string, std::string>::iterator p = m_MetaData.find( key );
-    if( p == m_MetaData.end() )
+    std::map<std::string, std::string>::iterator p = m_StaticData->metaData.find( key );
+    if( p == m_StaticData->metaData.end() )
         throw Exception( "[Level::getMetaData] meta data not found" );
     return p->second;
 }
@@ -62,24 +165,26 @@ const std::string& Level::getMetaData( const std::string& key )
 // --------------------------------------------------------------
 void Level::streamAllMetaData( std::ostream& stream )
 {
-    for( std::map<std::string, std::string>::iterator it = m_MetaData.begin(); it != m_MetaData.end(); ++it )
+    for( std::map<std::string, std::string>::iterator it = m_StaticData->metaData.begin(); it != m_StaticData->metaData.end(); ++it )
         stream << it->first << ": " << it->second << std::endl;
 }
 
 // --------------------------------------------------------------
 void Level::addHeaderData( const std::string& header )
 {
-    m_HeaderData.push_back( header );
+    StaticData& data = this->getWritableStaticData();
+    data.headerData.push_back( header );
 }
 
 // --------------------------------------------------------------
 void Level::removeHeaderData( const std::string& header )
 {
-    for( std::vector<std::string>::iterator it = m_HeaderData.begin(); it != m_HeaderData.end(); ++it )
+    StaticData& data = this->getWritableStaticData();
+    for( std::vector<std::string>::iterator it = data.headerData.begin(); it != data.headerData.end(); ++it )
     {
         if( it->compare( header ) == 0 )
         {
-            m_HeaderData.erase( it );
+            data.headerData.erase( it );
             break;
         }
     }
@@ -88,51 +193,150 @@ void Level::removeHeaderData( const std::string& header )
 // --------------------------------------------------------------
 void Level::streamAllHeaderData( std::ostream& stream )
 {
-    for( std::vector<std::string>::iterator it = m_HeaderData.begin(); it != m_HeaderData.end(); ++it )
+    for( std::vector<std::string>::iterator it = m_StaticData->headerData.begin(); it != m_StaticData->headerData.end(); ++it )
         stream << *it << std::endl;
 }
 
 // --------------------------------------------------------------
 void Level::insertTile( const Chocobun::Uint32& x, const Chocobun::Uint32& y, const char& tile )
 {
+    StaticData& data = this->getWritableStaticData();
 
     // check if character is valid
     if( validTiles.find_first_of(tile) == std::string::npos )
         throw Exception( "[Level::insertTile] attempt to insert invalid character into level array" );
 
-    // resize array if necessary
-    while( x+1 > m_LevelArray.size() )
+    // resize layers if necessary
+    if( x+1 > data.sizeX || y+1 > data.sizeY )
+        this->resizeTileBuffer( std::max(x+1, data.sizeX), std::max(y+1, data.sizeY) );
+
+    // remove whatever was on this tile before
+    Uint32 index = this->getTileIndex( x, y );
+    if( data.playerCount && m_State.playerIndex == index )
+        --data.playerCount;
+    m_State.boxes.clear( index );
+    data.goals.clear( index );
+
+    // split tile into the static and dynamic layers
+    bool isGoal = ( tile == '.' || tile == '*' || tile == '+' || tile == 'P' || tile == 'B' );
+    if( tile == '#' || tile == '_' )
+        data.tiles[index] = tile;
+    else
+        data.tiles[index] = ( isGoal ? '.' : ' ' );
+    if( isGoal )
+        data.goals.set( index );
+    if( tile == '$' || tile == '*' || tile == 'b' || tile == 'B' )
+        m_State.boxes.set( index );
+    if( tile == '@' || tile == '+' || tile == 'p' || tile == 'P' )
     {
-        m_LevelArray.push_back( std::vector<char>(0) );
-        m_LevelArray[m_LevelArray.size()-1].resize( m_LevelArray[0].size(), 32 );
+        m_State.playerIndex = index;
+        ++data.playerCount;
     }
-    if( y+1 > m_LevelArray[0].size() )
-        for( size_t i = 0; i != m_LevelArray.size(); ++i )
-            m_LevelArray[i].resize( y+1, 32 );
 
-    // write tile
-    m_LevelArray[x][y] = tile;
+    m_TileBufferIsDirty = true;
+    m_TileDataViewIsDirty = true;
 
 }
 
 // --------------------------------------------------------------
 void Level::insertTileLine( const Chocobun::Uint32& y, const std::string& tiles )
 {
+    if( tiles.size() > m_StaticData->sizeX || y+1 > m_StaticData->sizeY )
+        this->resizeTileBuffer( std::max<Uint32>(tiles.size(), m_StaticData->sizeX), std::max(y+1, m_StaticData->sizeY) );
     for( size_t x = 0; x != tiles.size(); ++x )
         this->insertTile( x, y, tiles[x] );
 }
 
+// --------------------------------------------------------------
+void Level::resizeTileBuffer( Uint32 sizeX, Uint32 sizeY )
+{
+    StaticData& data = this->getWritableStaticData();
+
+    // new static layer is filled with walls, then the inside is cleared to floor
+    Uint32 stride = sizeX + 2;
+    Uint32 tileCount = stride * (sizeY+2);
+    std::vector<char> staticTiles( tileCount, '#' );
+    Bitfield goalBits( tileCount );
+    Bitfield boxBits( tileCount );
+    for( Uint32 y = 0; y != sizeY; ++y )
+        for( Uint32 x = 0; x != sizeX; ++x )
+            staticTiles[(y+1)*stride + x+1] = ' ';
+
+    // the player index is remapped once after copying. Remapping it while
+    // copying would move it again whenever its new index is the old index
+    // of a tile copied later
+    Uint32 playerX = m_State.playerIndex % data.stride - 1;
+    Uint32 playerY = m_State.playerIndex / data.stride - 1;
+
+    // copy old tiles over
+    for( Uint32 y = 0; y != data.sizeY; ++y )
+    {
+        for( Uint32 x = 0; x != data.sizeX; ++x )
+        {
+            Uint32 oldIndex = this->getTileIndex( x, y );
+            Uint32 newIndex = (y+1)*stride + x+1;
+            staticTiles[newIndex] = data.tiles[oldIndex];
+            if( data.goals.test(oldIndex) ) goalBits.set( newIndex );
+            if( m_State.boxes.test(oldIndex) ) boxBits.set( newIndex );
+        }
+    }
+
+    data.tiles.swap( staticTiles );
+    std::swap( data.goals, goalBits );
+    std::swap( m_State.boxes, boxBits );
+    if( data.playerCount ) m_State.playerIndex = (playerY+1)*stride + playerX+1;
+    data.sizeX = sizeX;
+    data.sizeY = sizeY;
+    data.stride = stride;
+
+    // precompute index offsets for each direction
+    data.directionOffset[DIRECTION_UP] = -static_cast<Int32>(data.stride);
+    data.directionOffset[DIRECTION_DOWN] = static_cast<Int32>(data.stride);
+    data.directionOffset[DIRECTION_LEFT] = -1;
+    data.directionOffset[DIRECTION_RIGHT] = 1;
+
+    m_TileBufferIsDirty = true;
+    m_TileDataViewIsDirty = true;
+}
+
+// --------------------------------------------------------------
+Uint32 Level::getTileIndex( Uint32 x, Uint32 y ) const
+{
+    return (y+1)*m_StaticData->stride + x+1;
+}
+
+// --------------------------------------------------------------
+char Level::composeTile( Uint32 index ) const
+{
+    bool isGoal = m_StaticData->goals.test( index );
+    if( m_StaticData->playerCount && index == m_State.playerIndex )
+        return ( isGoal ? '+' : '@' );
+    if( m_State.boxes.test(index) )
+        return ( isGoal ? '*' : '$' );
+    return m_StaticData->tiles[index];
+}
+
+// --------------------------------------------------------------
+void Level::updateTileBuffer( void ) const
+{
+    if( !m_TileBufferIsDirty ) return;
+    m_TileBuffer.resize( m_StaticData->tiles.size() );
+    for( Uint32 index = 0; index != m_StaticData->tiles.size(); ++index )
+        m_TileBuffer[index] = this->composeTile( index );
+    m_TileBufferIsDirty = false;
+}
+
 // --------------------------------------------------------------
 void Level::streamAllTileData( std::ostream& stream, bool newLine )
 {
-    for( size_t y = 0; y != m_LevelArray[0].size(); ++y )
+    this->updateTileBuffer();
+    for( Uint32 y = 0; y != m_StaticData->sizeY; ++y )
     {
-        for( size_t x = 0; x != m_LevelArray.size(); ++x )
-            stream << m_LevelArray[x][y];
+        stream.write( &m_TileBuffer[this->getTileIndex(0, y)], m_StaticData->sizeX );
         if( newLine )
-            stream << std::endl;
+            stream << '\n';
         else
-            stream << "|";
+            stream << '|';
     }
     if( !newLine ) stream << std::endl;
 }
@@ -140,43 +344,57 @@ void Level::streamAllTileData( std::ostream& stream, bool newLine )
 // --------------------------------------------------------------
 const std::vector< std::vector<char> >& Level::getTileData( void ) const
 {
-    return m_LevelArray;
+    if( m_TileDataViewIsDirty )
+    {
+        this->updateTileBuffer();
+        m_TileDataView.resize( m_StaticData->sizeX );
+        for( Uint32 x = 0; x != m_StaticData->sizeX; ++x )
+        {
+            m_TileDataView[x].resize( m_StaticData->sizeY );
+            for( Uint32 y = 0; y != m_StaticData->sizeY; ++y )
+                m_TileDataView[x][y] = m_TileBuffer[this->getTileIndex(x, y)];
+        }
+        m_TileDataViewIsDirty = false;
+    }
+    return m_TileDataView;
 }
 
 // --------------------------------------------------------------
 char Level::getTile( Uint32 x, Uint32 y ) const
 {
-    if( x < 1 || x > m_LevelArray.size() ) return '\0';
-    if( y < 1 || y > m_LevelArray[0].size() ) return '\0';
-    return m_LevelArray[x-1][y-1];
+    if( x < 1 || x > m_StaticData->sizeX ) return '\0';
+    if( y < 1 || y > m_StaticData->sizeY ) return '\0';
+    return this->composeTile( this->getTileIndex(x-1, y-1) );
 }
 
 // --------------------------------------------------------------
 Uint32 Level::getSizeX( void ) const
 {
-    return m_LevelArray.size();
+    return m_StaticData->sizeX;
 }
 
 // --------------------------------------------------------------
 Uint32 Level::getSizeY( void ) const
 {
-    return m_LevelArray[0].size();
+    return m_StaticData->sizeY;
 }
 
 // --------------------------------------------------------------
 void Level::addLevelNote( const std::string& note )
 {
-    m_Notes.push_back( note );
+    StaticData& data = this->getWritableStaticData();
+    data.notes.push_back( note );
 }
 
 // --------------------------------------------------------------
 void Level::removeLevelNote( const std::string& note)
 {
-    for( std::vector<std::string>::iterator it = m_Notes.begin(); it != m_Notes.end(); ++it )
+    StaticData& data = this->getWritableStaticData();
+    for( std::vector<std::string>::iterator it = data.notes.begin(); it != data.notes.end(); ++it )
     {
         if( it->compare( note ) == 0 )
         {
-            m_Notes.erase( it );
+            data.notes.erase( it );
             break;
         }
     }
@@ -185,51 +403,54 @@ void Level::removeLevelNote( const std::string& note)
 // --------------------------------------------------------------
 void Level::streamAllNotes( std::ostream& stream )
 {
-    for( std::vector<std::string>::iterator it = m_Notes.begin(); it != m_Notes.end(); ++it )
+    for( std::vector<std::string>::iterator it = m_StaticData->notes.begin(); it != m_StaticData->notes.end(); ++it )
         stream << *it << std::endl;
 }
 
 // --------------------------------------------------------------
 void Level::setLevelName( const std::string& name )
 {
-    m_LevelName = name;
+    StaticData& data = this->getWritableStaticData();
+    data.levelName = name;
 }
 
 // --------------------------------------------------------------
 std::string Level::getLevelName( void ) const
 {
-    return m_LevelName;
+    return m_StaticData->levelName;
 }
 
 // --------------------------------------------------------------
 bool Level::validateLevel( void )
 {
-
     // does another check need to be done?
     if( m_IsLevelValid ) return true;
 
+    StaticData& data = this->getWritableStaticData();
+
     // make sure there's only one player
-    // this also sets the internal positions of the player
-    bool playerFound = false;
-    for( size_t x = 0; x != m_LevelArray.size(); ++x )
-    {
-        for( size_t y = 0; y != m_LevelArray[0].size(); ++y )
-        {
-            if( m_LevelArray[x][y] == '@' )
-            {
-                if( playerFound )
-                {
-                    return false;
-                }else
-                {
-                    m_PlayerX = x;
-                    m_PlayerY = y;
-                    playerFound = true;
-                }
-
-            }
-        }
-    }
+    if( data.playerCount != 1 ) return false;
+
+    // build the cell graph used by analysis code
+    data.compiledLevel.compile( data.tiles, data.goals, data.stride, m_State.playerIndex );
+    data.deadSquares.reset( data.tiles.size() );
+    for( Uint32 cell = 0; cell != data.compiledLevel.getCellCount(); ++cell )
+        if( data.compiledLevel.isDead( cell ) )
+            data.deadSquares.set( data.compiledLevel.getTileIndex( cell ) );
+
+    // from here on the box counters are maintained incrementally
+    data.boxCount = m_State.boxes.count();
+    m_State.boxesOnGoals = m_State.boxes.countCommon( data.goals );
+    m_State.boxHash = 0;
+    for( Uint32 index = 0; index != data.tiles.size(); ++index )
+        if( m_State.boxes.test(index) )
+            m_State.boxHash ^= Zobrist::getBoxKey( index );
+    m_NormalisedPlayerIndexIsDirty = true;
+
+    // the initial state is the first snapshot of the move history
+    m_History.clear();
+    m_History.addSnapshot( m_State );
+    m_HistoryIndex = 0;
 
     // arriving here means the level is valid
     m_IsLevelValid = true;
@@ -240,94 +461,284 @@ bool Level::validateLevel( void )
 void Level::moveUp( void )
 {
     if( !m_IsLevelValid ) return;
-    if( !this->movePlayer( 'u' ) ) return;
-    --m_PlayerY;
+    this->movePlayer( DIRECTION_UP );
 }
 
 // --------------------------------------------------------------
 void Level::moveDown( void )
 {
     if( !m_IsLevelValid ) return;
-    if( !this->movePlayer( 'd' ) ) return;
-    ++m_PlayerY;
+    this->movePlayer( DIRECTION_DOWN );
 }
 
 // --------------------------------------------------------------
 void Level::moveLeft( void )
 {
     if( !m_IsLevelValid ) return;
-    if( !this->movePlayer( 'l' ) ) return;
-    --m_PlayerX;
+    this->movePlayer( DIRECTION_LEFT );
 }
 
 // --------------------------------------------------------------
 void Level::moveRight( void )
 {
     if( !m_IsLevelValid ) return;
-    if( !this->movePlayer( 'r' ) ) return;
-    ++m_PlayerX;
+    this->movePlayer( DIRECTION_RIGHT );
 }
 
 // --------------------------------------------------------------
-bool Level::movePlayer( char direction )
+Uint32 Level::applyMoves( const char* moves, size_t count )
 {
+    if( !m_IsLevelValid ) return 0;
 
-    bool isPushingBox = false;
+    for( size_t i = 0; i != count; ++i )
+    {
+        Int8 direction = moveDirections.table[static_cast<Uint8>(moves[i])];
+        if( direction < 0 || !this->movePlayer( static_cast<Direction>(direction) ) )
+            return i;
+    }
+    return count;
+}
 
-    // calculate new positions of player
-    Uint32 newX = m_PlayerX, newY = m_PlayerY;
-    if( direction == 'u' ) --newY;
-    if( direction == 'd' ) ++newY;
-    if( direction == 'l' ) --newX;
-    if( direction == 'r' ) ++newX;
+// --------------------------------------------------------------
+Uint32 Level::replayMoves( const char* moves, size_t count, LevelState& state, Uint32& pushes ) const
+{
+    pushes = 0;
+    if( !m_IsLevelValid ) return 0;
+
+    // same rules as movePlayer, minus the history and the listeners
+    const StaticData& data = *m_StaticData;
+    state = m_State;
+    for( size_t i = 0; i != count; ++i )
+    {
+        Int8 direction = moveDirections.table[static_cast<Uint8>(moves[i])];
+        if( direction < 0 ) return i;
+        Int32 offset = data.directionOffset[direction];
+        Uint32 newIndex = state.playerIndex + offset;
+        if( data.tiles[newIndex] == '#' ) return i;
+        if( state.boxes.test( newIndex ) )
+        {
+            Uint32 nextIndex = newIndex + offset;
+            if( data.tiles[nextIndex] == '#' || state.boxes.test( nextIndex ) ) return i;
+            state.boxes.move( newIndex, nextIndex );
+            state.boxesOnGoals += data.goals.test( nextIndex );
+            state.boxesOnGoals -= data.goals.test( newIndex );
+            state.boxHash ^= Zobrist::getBoxKey( newIndex ) ^ Zobrist::getBoxKey( nextIndex );
+            ++pushes;
+        }
+        state.playerIndex = newIndex;
+    }
+    return count;
+}
 
-    // calculate next step the player would take if traveling linearly
-    Uint32 nextX = newX + (newX-m_PlayerX);
-    Uint32 nextY = newY + (newY-m_PlayerY);
+// --------------------------------------------------------------
+bool Level::findPath( Uint32 x, Uint32 y, std::string& moves ) const
+{
+    moves.clear();
+    if( !m_IsLevelValid ) return false;
 
-    // can't move up if there is a wall
-    if( m_LevelArray[newX][newY] == '#' ) return false;
+    const CompiledLevel& graph = m_StaticData->compiledLevel;
+    Uint32 target = graph.getCell( x, y );
+    if( target == CompiledLevel::NO_CELL ) return false;
+    return this->findWalk( graph.getCell(m_State.playerIndex), target, CompiledLevel::NO_CELL, CompiledLevel::NO_CELL, moves );
+}
 
-    // can't move up if box is against a wall or another box
-    if( m_LevelArray[newX][newY] == '$' || m_LevelArray[newX][newY] == '*' )
+// --------------------------------------------------------------
+bool Level::findBoxPath( Uint32 fromX, Uint32 fromY, Uint32 toX, Uint32 toY, std::string& moves ) const
+{
+    moves.clear();
+    if( !m_IsLevelValid ) return false;
+
+    const CompiledLevel& graph = m_StaticData->compiledLevel;
+    const Uint32 NO_CELL = CompiledLevel::NO_CELL;
+    Uint32 from = graph.getCell( fromX, fromY );
+    Uint32 to = graph.getCell( toX, toY );
+    if( from == NO_CELL || to == NO_CELL ) return false;
+    if( !m_State.boxes.test( graph.getTileIndex(from) ) ) return false;
+    if( to == from ) return true;
+    if( m_State.boxes.test( graph.getTileIndex(to) ) ) return false;
+
+    // prepare scratch buffers. A search state is a box cell combined with
+    // the direction of the push that moved the box there (cell*4 + direction)
+    Uint32 stateCount = graph.getCellCount() * 4;
+    if( m_PushMarks.size() != stateCount )
     {
-        if( m_LevelArray[nextX][nextY] == '#' ||
-            m_LevelArray[nextX][nextY] == '$' ||
-            m_LevelArray[nextX][nextY] == '*' )
-            return false;
-        isPushingBox = true;
+        m_PushQueue.resize( stateCount );
+        m_PushMarks.assign( stateCount, 0 );
+        m_PushParents.resize( stateCount );
+        m_PushMark = 0;
+    }
+    if( ++m_PushMark == 0 )
+    {
+        std::fill( m_PushMarks.begin(), m_PushMarks.end(), 0 );
+        m_PushMark = 1;
+    }
+
+    // breadth-first search over pushes, so the first path found has the
+    // fewest pushes. The player's reachable area is flood filled for every
+    // state, with the dragged box moved to the state's cell
+    Uint32 head = 0, tail = 0;
+    Uint32 found = NO_CELL;
+    Uint32 parent = NO_CELL;
+    Uint32 box = from;
+    Uint32 player = graph.getCell( m_State.playerIndex );
+    for(;;)
+    {
+        std::string unused;
+        this->findWalk( player, NO_CELL, from, box, unused );
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 side = graph.getNeighbour( box, direction ^ 1 );
+            Uint32 next = graph.getNeighbour( box, direction );
+            if( side == NO_CELL || m_PathMarks[side] != m_PathMark ) continue;
+            if( next == NO_CELL || (next != from && m_State.boxes.test( graph.getTileIndex(next) )) ) continue;
+            Uint32 state = next*4 + direction;
+            if( m_PushMarks[state] == m_PushMark ) continue;
+            m_PushMarks[state] = m_PushMark;
+            m_PushParents[state] = parent;
+            m_PushQueue[tail++] = state;
+            if( next == to ) { found = state; break; }
+        }
+        if( found != NO_CELL || head == tail ) break;
+
+        // after a push the player stands where the box was
+        parent = m_PushQueue[head++];
+        box = parent / 4;
+        player = graph.getNeighbour( box, (parent & 3) ^ 1 );
+    }
+    if( found == NO_CELL ) return false;
+
+    // collect the pushes in order, reusing the queue as storage
+    Uint32 pushCount = 0;
+    for( Uint32 state = found; state != NO_CELL; state = m_PushParents[state] )
+        m_PushQueue[pushCount++] = state;
+    std::reverse( m_PushQueue.begin(), m_PushQueue.begin() + pushCount );
+
+    // walk to the side of the box before each push, then push
+    player = graph.getCell( m_State.playerIndex );
+    box = from;
+    for( Uint32 i = 0; i != pushCount; ++i )
+    {
+        Uint32 direction = m_PushQueue[i] & 3;
+        this->findWalk( player, graph.getNeighbour( box, direction ^ 1 ), from, box, moves );
+        moves += "UDLR"[direction];
+        player = box;
+        box = m_PushQueue[i] / 4;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------
+bool Level::findWalk( Uint32 start, Uint32 target, Uint32 movedBoxFrom, Uint32 movedBoxTo, std::string& moves ) const
+{
+    const CompiledLevel& graph = m_StaticData->compiledLevel;
+    if( target == start ) return true;
+
+    // prepare scratch buffers
+    if( m_PathMarks.size() != graph.getCellCount() )
+    {
+        m_PathQueue.resize( graph.getCellCount() );
+        m_PathMarks.assign( graph.getCellCount(), 0 );
+        m_PathDirections.resize( graph.getCellCount() );
+        m_PathMark = 0;
+    }
+    if( ++m_PathMark == 0 )
+    {
+        std::fill( m_PathMarks.begin(), m_PathMarks.end(), 0 );
+        m_PathMark = 1;
+    }
+
+    // breadth-first search from the start. Every cell is queued at most
+    // once, so the queue never wraps around
+    Uint32 head = 0, tail = 0;
+    m_PathQueue[tail++] = start;
+    m_PathMarks[start] = m_PathMark;
+    while( head != tail )
+    {
+        Uint32 cell = m_PathQueue[head++];
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 next = graph.getNeighbour( cell, direction );
+            if( next == CompiledLevel::NO_CELL || m_PathMarks[next] == m_PathMark ) continue;
+            if( next == movedBoxTo ) continue;
+            if( next != movedBoxFrom && m_State.boxes.test( graph.getTileIndex(next) ) ) continue;
+            m_PathMarks[next] = m_PathMark;
+            m_PathDirections[next] = static_cast<Uint8>( direction );
+            m_PathQueue[tail++] = next;
+        }
+        if( target != CompiledLevel::NO_CELL && m_PathMarks[target] == m_PathMark ) break;
     }
+    if( target == CompiledLevel::NO_CELL || m_PathMarks[target] != m_PathMark ) return false;
 
-    // move box up (if any)
+    // walk back from the target, then reverse the appended part
+    std::string::size_type begin = moves.size();
+    for( Uint32 cell = target; cell != start; cell = graph.getNeighbour( cell, m_PathDirections[cell] ^ 1 ) )
+        moves += "udlr"[m_PathDirections[cell]];
+    std::reverse( moves.begin() + begin, moves.end() );
+    return true;
+}
+
+// --------------------------------------------------------------
+bool Level::moveTo( Uint32 x, Uint32 y )
+{
+    if( !this->findPath( x, y, m_PathMoves ) ) return false;
+    this->applyMoves( m_PathMoves.data(), m_PathMoves.size() );
+    return true;
+}
+
+// --------------------------------------------------------------
+bool Level::movePlayer( Direction direction, bool isRedo )
+{
+    const StaticData& data = *m_StaticData;
+
+    // the tile the player moves to and the tile after that
+    Int32 offset = data.directionOffset[direction];
+    Uint32 newIndex = m_State.playerIndex + offset;
+    Uint32 nextIndex = newIndex + offset;
+
+    // can't move if there is a wall
+    if( data.tiles[newIndex] == '#' ) return false;
+
+    // can't move if box is against a wall or another box
+    bool isPushingBox = m_State.boxes.test( newIndex );
     if( isPushingBox )
     {
-        if( m_LevelArray[newX][newY] == '$' )
-            m_LevelArray[newX][newY] = ' ';   // box is on floor, expose floor
-        else
-            m_LevelArray[newX][newY] = '.';   // box is on goal, expose goal
-        if( m_LevelArray[nextX][nextY] == '.' )
-            m_LevelArray[nextX][nextY] = '*';   // target is goal, place box on goal
-        else
-            m_LevelArray[nextX][nextY] = '$';     // target is floor, place box on floor
+        if( data.tiles[nextIndex] == '#' || m_State.boxes.test(nextIndex) )
+            return false;
+        m_State.boxes.move( newIndex, nextIndex );
+        this->updateBoxCounters( newIndex, nextIndex );
     }
 
-    // move player up
-    if( m_LevelArray[newX][newY] == ' ' )
-        m_LevelArray[newX][newY] = '@';     // target is floor, place player on floor
-    else
-        m_LevelArray[newX][newY] = '+';     // target is goal, place player on goal
-    if( m_LevelArray[m_PlayerX][m_PlayerY] == '@')
-        m_LevelArray[m_PlayerX][m_PlayerY] = ' ';
-    else
-        m_LevelArray[m_PlayerX][m_PlayerY] = '+';
+    // move player
+    Uint32 changedIndices[3] = { m_State.playerIndex, newIndex, nextIndex };
+    m_State.playerIndex = newIndex;
+    m_TileBufferIsDirty = true;
+    m_TileDataViewIsDirty = true;
+    if( !m_Listeners.empty() )
+        this->notifyTilesChanged( changedIndices, isPushingBox ? 3 : 2 );
+
+    // record the move, discarding any redo data. Redo replays moves that
+    // are already in the history, so they only need to be counted
+    if( !isRedo )
+    {
+        m_History.truncate( m_HistoryIndex );
+        m_History.push( direction | (isPushingBox ? MoveHistory::PUSH_FLAG : 0) );
+    }
+    ++m_HistoryIndex;
+    if( m_History.needsSnapshot( m_HistoryIndex ) )
+        m_History.addSnapshot( m_State );
+
+    // notify listeners if this push solved the level. The box must have
+    // come from a non-goal tile, otherwise the level was solved before
+    if( isPushingBox && m_State.boxesOnGoals == data.boxCount && !data.goals.test(newIndex) )
+        for( std::vector<LevelListener*>::iterator it = m_Listeners.begin(); it != m_Listeners.end(); ++it )
+            (*it)->onLevelSolved( *this );
 
-    // generate undo data
-    if( isPushingBox ) direction -= 32; // convert to upper case for pushing boxes
-    if( m_UndoDataIndex != -1 )
-        while( m_UndoData.size() != m_UndoDataIndex )
-            m_UndoData.pop_back();
-    m_UndoData.push_back( direction );
-    ++m_UndoDataIndex;
+    // a push can freeze the box in a deadlock or complete a deadlocked
+    // pattern. Both only look at the neighbourhood of the box, so they are
+    // cheap enough for every push
+    if( isPushingBox && !m_Listeners.empty() && (this->isFrozenBox( nextIndex ) || this->isPatternDeadlock( nextIndex )) )
+        for( std::vector<LevelListener*>::iterator it = m_Listeners.begin(); it != m_Listeners.end(); ++it )
+            (*it)->onLevelDeadlocked( *this, nextIndex % data.stride - 1, nextIndex / data.stride - 1 );
 
     return true;
 }
@@ -335,64 +746,324 @@ bool Level::movePlayer( char direction )
 // --------------------------------------------------------------
 void Level::undo( void )
 {
+    const StaticData& data = *m_StaticData;
     if( !m_IsLevelValid ) return;
-    if( m_UndoDataIndex == -1 ) return;
+    if( m_HistoryIndex == 0 ) return;
 
     // get undo move
-    char move = m_UndoData.at( m_UndoDataIndex );
-    --m_UndoDataIndex;
+    --m_HistoryIndex;
+    Uint8 move = m_History.get( m_HistoryIndex );
 
-    // determine if a box was pushed and convert to lower case
-    bool boxPushed = false;
-    if( move == 'U' || move == 'D' || move == 'L' || move == 'R' )
+    // revert back player position, pulling the box along if it was pushed
+    Int32 offset = data.directionOffset[move & 3];
+    Uint32 changedIndices[3] = { m_State.playerIndex, m_State.playerIndex - offset, m_State.playerIndex + offset };
+    if( move & MoveHistory::PUSH_FLAG )
     {
-        boxPushed = true;
-        move += 32; // convert to lower case
+        m_State.boxes.move( m_State.playerIndex + offset, m_State.playerIndex );
+        this->updateBoxCounters( m_State.playerIndex + offset, m_State.playerIndex );
     }
+    m_State.playerIndex -= offset;
 
-    // calculate old positions
-    Uint32 oldX = m_PlayerX, oldY = m_PlayerY;
-    if( move == 'u' ) ++oldY;
-    if( move == 'd' ) --oldY;
-    if( move == 'l' ) ++oldX;
-    if( move == 'r' ) --oldX;
+    m_TileBufferIsDirty = true;
+    m_TileDataViewIsDirty = true;
+    if( !m_Listeners.empty() )
+        this->notifyTilesChanged( changedIndices, (move & MoveHistory::PUSH_FLAG) ? 3 : 2 );
+}
 
-    // calculate previous step player would have taken if he were traveling linearly
-    Uint32 previousX = oldX + (oldX-m_PlayerX);
-    Uint32 previousY = oldY + (oldY-m_PlayerY);
+// --------------------------------------------------------------
+void Level::redo( void )
+{
+    if( !m_IsLevelValid ) return;
+    if( m_HistoryIndex == m_History.size() ) return;
+    this->movePlayer( static_cast<Direction>(m_History.get( m_HistoryIndex ) & 3), true );
+}
 
-    // revert back player position
-    if( m_LevelArray[m_PlayerX][m_PlayerY] == '@' )
-        m_LevelArray[m_PlayerX][m_PlayerY] = ' ';
-    else
-        m_LevelArray[m_PlayerX][m_PlayerY] = '+';
-    if( m_LevelArray[oldX][oldY] == ' ' )
-        m_LevelArray[oldX][oldY] = '@';
-    else
-        m_LevelArray[oldX][oldY] = '+';
+// --------------------------------------------------------------
+void Level::seekToMove( Uint32 move )
+{
+    if( !m_IsLevelValid ) return;
+    if( move > m_History.size() ) return;
 
-    // player was pushing a box
-    if( boxPushed )
+    // walk there directly if that's less work than restoring a snapshot
+    Uint32 snapshotMove = 0;
+    const LevelState* snapshot = m_History.findSnapshot( move, snapshotMove );
+    if( move >= m_HistoryIndex && move - m_HistoryIndex <= move - snapshotMove )
     {
-        if( m_LevelArray[previousX][previousY] == '$' )
-            m_LevelArray[previousX][previousY] = ' ';
-        else
-            m_LevelArray[previousX][previousY] = '.';
-        if( m_LevelArray[oldX][oldY] == ' ')
-            m_LevelArray[oldX][oldY] = '$';
-        else
-            m_LevelArray[oldX][oldY] = '*';
+        while( m_HistoryIndex != move ) this->redo();
+        return;
+    }
+    if( move < m_HistoryIndex && m_HistoryIndex - move <= move - snapshotMove )
+    {
+        while( m_HistoryIndex != move ) this->undo();
+        return;
     }
 
+    // restore the snapshot and replay the rest
+    this->restoreSnapshot( *snapshot, snapshotMove );
+    while( m_HistoryIndex != move ) this->redo();
 }
 
 // --------------------------------------------------------------
-void Level::redo( void )
+Uint32 Level::getMoveCount( void ) const
 {
+    return m_HistoryIndex;
+}
+
+// --------------------------------------------------------------
+Uint32 Level::getHistorySize( void ) const
+{
+    return m_History.size();
+}
+
+// --------------------------------------------------------------
+void Level::setSnapshotInterval( Uint32 interval )
+{
+    m_History.setSnapshotInterval( interval );
     if( !m_IsLevelValid ) return;
-    if( m_UndoDataIndex == m_UndoData.size()-1 ) return;
-    this->movePlayer( m_UndoData.at(m_UndoDataIndex) );
-    ++m_UndoDataIndex;
+
+    // replay the whole history from the start so snapshots are taken again
+    Uint32 move = m_HistoryIndex;
+    Uint32 snapshotMove = 0;
+    this->restoreSnapshot( *m_History.findSnapshot( 0, snapshotMove ), 0 );
+    while( m_HistoryIndex != m_History.size() ) this->redo();
+    this->seekToMove( move );
+}
+
+// --------------------------------------------------------------
+void Level::reset( void )
+{
+    if( !m_IsLevelValid ) return;
+    this->seekToMove( 0 );
+    m_History.truncate( 0 );
+}
+
+// --------------------------------------------------------------
+void Level::restoreSnapshot( const LevelState& snapshot, Uint32 moveCount )
+{
+    m_State = snapshot;
+    m_HistoryIndex = moveCount;
+    m_NormalisedPlayerIndexIsDirty = true;
+
+    m_TileBufferIsDirty = true;
+    m_TileDataViewIsDirty = true;
+    this->notifyLevelChanged();
 }
 
+// --------------------------------------------------------------
+bool Level::isSolved( void ) const
+{
+    assert( !m_IsLevelValid || (m_State.boxesOnGoals == m_StaticData->boxCount) == this->allBoxesOnGoals() );
+    return m_IsLevelValid && m_State.boxesOnGoals == m_StaticData->boxCount;
+}
+
+// --------------------------------------------------------------
+bool Level::isSolved( const LevelState& state ) const
+{
+    return m_IsLevelValid && state.boxesOnGoals == m_StaticData->boxCount;
+}
+
+// --------------------------------------------------------------
+void Level::addListener( LevelListener* listener )
+{
+    if( std::find( m_Listeners.begin(), m_Listeners.end(), listener ) == m_Listeners.end() )
+        m_Listeners.push_back( listener );
+}
+
+// --------------------------------------------------------------
+void Level::removeListener( LevelListener* listener )
+{
+    std::vector<LevelListener*>::iterator it = std::find( m_Listeners.begin(), m_Listeners.end(), listener );
+    if( it != m_Listeners.end() )
+        m_Listeners.erase( it );
+}
+
+// --------------------------------------------------------------
+void Level::notifyTilesChanged( const Uint32* indices, Uint32 count ) const
+{
+    const Uint32 stride = m_StaticData->stride;
+    TileChange changes[3];
+    for( Uint32 i = 0; i != count; ++i )
+    {
+        changes[i].x = indices[i] % stride - 1;
+        changes[i].y = indices[i] / stride - 1;
+        changes[i].tile = this->composeTile( indices[i] );
+    }
+    for( std::vector<LevelListener*>::const_iterator it = m_Listeners.begin(); it != m_Listeners.end(); ++it )
+        (*it)->onTilesChanged( *this, changes, count );
+}
+
+// --------------------------------------------------------------
+void Level::notifyLevelChanged( void ) const
+{
+    for( std::vector<LevelListener*>::const_iterator it = m_Listeners.begin(); it != m_Listeners.end(); ++it )
+        (*it)->onLevelChanged( *this );
+}
+
+// --------------------------------------------------------------
+Level Level::createBranch( void ) const
+{
+    Level branch( m_StaticData, m_State );
+    branch.m_NormalisedPlayerIndex = m_NormalisedPlayerIndex;
+    branch.m_NormalisedPlayerIndexIsDirty = m_NormalisedPlayerIndexIsDirty;
+    branch.m_PatternDatabase = m_PatternDatabase;
+    branch.m_IsLevelValid = m_IsLevelValid;
+    if( m_IsLevelValid )
+        branch.m_History.addSnapshot( m_State );
+    return branch;
+}
+
+// --------------------------------------------------------------
+void Level::saveState( LevelState& state ) const
+{
+    state = m_State;
+}
+
+// --------------------------------------------------------------
+void Level::restoreState( const LevelState& state )
+{
+    if( !m_IsLevelValid ) return;
+
+    // the restored position becomes the start of a new history
+    m_History.clear();
+    m_History.addSnapshot( state );
+    this->restoreSnapshot( state, 0 );
+}
+
+// --------------------------------------------------------------
+bool Level::isDeadSquare( Uint32 x, Uint32 y ) const
+{
+    if( !m_IsLevelValid || x >= m_StaticData->sizeX || y >= m_StaticData->sizeY ) return false;
+    return m_StaticData->deadSquares.test( (y+1)*m_StaticData->stride + x+1 );
+}
+
+// --------------------------------------------------------------
+bool Level::isFreezeDeadlock( Uint32 x, Uint32 y ) const
+{
+    if( !m_IsLevelValid || x >= m_StaticData->sizeX || y >= m_StaticData->sizeY ) return false;
+    Uint32 index = (y+1)*m_StaticData->stride + x+1;
+    if( !m_State.boxes.test( index ) ) return false;
+    return this->isFrozenBox( index );
+}
+
+// --------------------------------------------------------------
+bool Level::isFrozenBox( Uint32 index ) const
+{
+    const CompiledLevel& compiledLevel = m_StaticData->compiledLevel;
+    const Bitfield& boxes = m_State.boxes;
+    Uint32 cell = compiledLevel.getCell( index );
+    if( cell == CompiledLevel::NO_CELL ) return false;
+    return compiledLevel.isFreezeDeadlock( cell, [&compiledLevel, &boxes]( Uint32 neighbour ) {
+        return boxes.test( compiledLevel.getTileIndex( neighbour ) );
+    });
+}
+
+// --------------------------------------------------------------
+bool Level::isPatternDeadlock( Uint32 index ) const
+{
+    if( !m_PatternDatabase ) return false;
+    const CompiledLevel& compiledLevel = m_StaticData->compiledLevel;
+    const Bitfield& boxes = m_State.boxes;
+    Uint32 cell = compiledLevel.getCell( index );
+    if( cell == CompiledLevel::NO_CELL ) return false;
+    return m_PatternDatabase->isDeadlock( compiledLevel, cell, [&compiledLevel, &boxes]( Uint32 neighbour ) {
+        return boxes.test( compiledLevel.getTileIndex( neighbour ) );
+    });
+}
+
+// --------------------------------------------------------------
+void Level::setPatternDatabase( const PatternDatabase* database )
+{
+    m_PatternDatabase = database;
+}
+
+// --------------------------------------------------------------
+const PatternDatabase* Level::getPatternDatabase( void ) const
+{
+    return m_PatternDatabase;
+}
+
+// --------------------------------------------------------------
+const CompiledLevel& Level::getCompiledLevel( void ) const
+{
+    return m_StaticData->compiledLevel;
+}
+
+// --------------------------------------------------------------
+Level::StaticData& Level::getWritableStaticData( void )
+{
+    if( m_StaticData.use_count() > 1 )
+        m_StaticData = std::make_shared<StaticData>( *m_StaticData );
+    return *m_StaticData;
+}
+
+// --------------------------------------------------------------
+bool Level::allBoxesOnGoals( void ) const
+{
+    return m_State.boxes.isSubsetOf( m_StaticData->goals );
+}
+
+// --------------------------------------------------------------
+void Level::updateBoxCounters( Uint32 from, Uint32 to )
+{
+    m_State.boxesOnGoals += m_StaticData->goals.test( to );
+    m_State.boxesOnGoals -= m_StaticData->goals.test( from );
+    m_State.boxHash ^= Zobrist::getBoxKey( from ) ^ Zobrist::getBoxKey( to );
+    m_NormalisedPlayerIndexIsDirty = true;
+}
+
+// --------------------------------------------------------------
+Uint64 Level::getHash( void ) const
+{
+    if( !m_IsLevelValid ) return 0;
+    if( m_NormalisedPlayerIndexIsDirty )
+    {
+        m_NormalisedPlayerIndex = this->findNormalisedPlayerIndex();
+        m_NormalisedPlayerIndexIsDirty = false;
+    }
+    return m_State.boxHash ^ Zobrist::getPlayerKey( m_NormalisedPlayerIndex );
+}
+
+// --------------------------------------------------------------
+Uint64 Level::getBoxHash( void ) const
+{
+    return m_State.boxHash;
+}
+
+// --------------------------------------------------------------
+Uint32 Level::findNormalisedPlayerIndex( void ) const
+{
+
+    // marks are compared against a running counter, so they never need clearing
+    if( m_FloodFillMarks.size() != m_StaticData->tiles.size() )
+    {
+        m_FloodFillMarks.assign( m_StaticData->tiles.size(), 0 );
+        m_FloodFillMark = 0;
+    }
+    if( ++m_FloodFillMark == 0 )
+    {
+        std::fill( m_FloodFillMarks.begin(), m_FloodFillMarks.end(), 0 );
+        m_FloodFillMark = 1;
+    }
+
+    Uint32 lowestIndex = m_State.playerIndex;
+    m_FloodFillStack.clear();
+    m_FloodFillStack.push_back( m_State.playerIndex );
+    m_FloodFillMarks[m_State.playerIndex] = m_FloodFillMark;
+    while( !m_FloodFillStack.empty() )
+    {
+        Uint32 index = m_FloodFillStack.back();
+        m_FloodFillStack.pop_back();
+        if( index < lowestIndex ) lowestIndex = index;
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 next = index + m_StaticData->directionOffset[direction];
+            if( m_FloodFillMarks[next] == m_FloodFillMark ) continue;
+            if( m_StaticData->tiles[next] == '#' || m_State.boxes.test(next) ) continue;
+            m_FloodFillMarks[next] = m_FloodFillMark;
+            m_FloodFillStack.push_back( next );
+        }
+    }
+    return lowestIndex;
+}
+
 } // namespace Chocobun
@@ -26,14 +26,25 @@
 // include files
 
 #include <core/Config.hpp>
+#include <core/Bitfield.hpp>
+#include <core/CompiledLevel.hpp>
+#include <core/LevelState.hpp>
+#include <core/MoveHistory.hpp>
 
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 #include <iostream>
 
 namespace Chocobun {
+
+// --------------------------------------------------------------
+// forward declarations
+
+class LevelListener;
+class PatternDatabase;
 
 /*!
  * @brief Holds information of a loaded level
@@ -50,6 +61,23 @@ public:
      * @brief Default Constructor
      */
     Level( void );
+
+    /*!
+     * @brief Copy constructor
+     *
+     * The static parts of the level (tiles, goals, meta data, header data
+     * and notes) are shared with the other level and only copied if one of
+     * them is modified. The position and the move history are copied.
+     * Listeners are not copied.
+     */
+    Level( const Level& other );
+
+    /*!
+     * @brief Assignment operator
+     *
+     * @see Level( const Level& )
+     */
+    Level& operator=( const Level& other );
 
     /*!
      * @brief Destructor
@@ -76,6 +104,14 @@ public:
      */
     void addMetaData( const std::string& key, const std::string& value );
 
+    /*!
+     * @brief Adds meta data to the level, replacing the entry of the key if there is one
+     *
+     * @param key The key of the entry
+     * @param value The value of the entry
+     */
+    void setMetaData( const std::string& key, const std::string& value );
+
     /*!
      * @brief Retrieves meta data of the level
      *
@@ -183,6 +219,11 @@ public:
     /*!
      * @brief Gets the array of tile data
      *
+     * Tiles are stored internally as a static layer (walls, goals, floor)
+     * and a dynamic layer (boxes, player). This builds a column-major
+     * compatibility view of them (indexed [x][y]) the first time it is
+     * requested after the level changed.
+     *
      * @return Returns a 2-dimensional array of chars containing tile data
      */
     const std::vector< std::vector<char> >& getTileData( void ) const;
@@ -287,6 +328,142 @@ public:
      */
     void moveRight( void );
 
+    /*!
+     * @brief Applies a sequence of moves in LURD notation
+     *
+     * This is the fast path for replaying solutions and bursts of input.
+     * The validity check and character decoding happen once per call or
+     * through a lookup table, instead of once per move.
+     *
+     * Both lower and upper case letters are accepted and treated the same,
+     * so solutions with pushes marked in upper case can be passed directly.
+     * Applying stops at the first move that is either blocked or not one of
+     * the characters "udlrUDLR".
+     *
+     * @param moves The moves to apply
+     * @param count The number of characters in moves
+     * @return The number of moves applied. If this is less than count, the
+     * move at that index is the first illegal move.
+     */
+    Uint32 applyMoves( const char* moves, size_t count );
+
+    /*!
+     * @brief Replays a sequence of moves in LURD notation without changing the level
+     *
+     * Moves are made on a copy of the current position instead of the level,
+     * so no history is recorded and no listeners are notified. Nothing is
+     * allocated per move and the level is only read, so many threads can
+     * replay on the same level at once. Move characters are handled the same
+     * way as by applyMoves.
+     *
+     * @param moves The moves to replay
+     * @param count The number of characters in moves
+     * @param state Receives the position reached. Passing the same object
+     * to many calls avoids allocating for every call
+     * @param pushes Receives the number of pushes among the moves replayed
+     * @return The number of moves replayed. If this is less than count, the
+     * move at that index is the first illegal move.
+     */
+    Uint32 replayMoves( const char* moves, size_t count, LevelState& state, Uint32& pushes ) const;
+
+    /*!
+     * @brief Finds the shortest walk of the player to a tile without pushing any boxes
+     *
+     * This is a breadth-first search over the cells of the compiled level.
+     * All buffers it needs are kept by the level and reused, so queries don't
+     * allocate memory once the first query was made.
+     *
+     * @param x The X coordinate of the target tile (0-based, like getTileData)
+     * @param y The Y coordinate of the target tile (0-based, like getTileData)
+     * @param moves Receives the walk in LURD notation (lower case). It is
+     * empty if the player is already standing on the target
+     * @return True if the player can walk to the target, false if it is
+     * blocked, isn't floor, or the level hasn't been validated
+     */
+    bool findPath( Uint32 x, Uint32 y, std::string& moves ) const;
+
+    /*!
+     * @brief Walks the player to a tile along the shortest path without pushing any boxes
+     *
+     * The walk is applied like any other moves, so it can be undone move by
+     * move and listeners are notified.
+     *
+     * @param x The X coordinate of the target tile (0-based, like getTileData)
+     * @param y The Y coordinate of the target tile (0-based, like getTileData)
+     * @return True if the player was moved to the target, false if it can't be reached
+     */
+    bool moveTo( Uint32 x, Uint32 y );
+
+    /*!
+     * @brief Finds how to push a box to a tile with the fewest pushes
+     *
+     * Only the given box is pushed; all other boxes stay where they are.
+     * The search is a breadth-first search over the cell of the box and the
+     * side the player pushed it from, so it also finds paths which require
+     * pushing the box from a different side halfway through. Like findPath,
+     * it reuses buffers kept by the level.
+     *
+     * @param fromX The X coordinate of the box (0-based, like getTileData)
+     * @param fromY The Y coordinate of the box (0-based, like getTileData)
+     * @param toX The X coordinate of the target tile (0-based, like getTileData)
+     * @param toY The Y coordinate of the target tile (0-based, like getTileData)
+     * @param moves Receives the moves in LURD notation, including the walks
+     * between pushes. Pushes are upper case, walks are lower case
+     * @return True if the box can be pushed to the target, false if it can't,
+     * there's no box at the given position, or the level hasn't been validated
+     */
+    bool findBoxPath( Uint32 fromX, Uint32 fromY, Uint32 toX, Uint32 toY, std::string& moves ) const;
+
+    /*!
+     * @brief Returns true if a box on a tile can never be pushed to a goal
+     *
+     * Dead squares are computed once by validateLevel, by pulling a box away
+     * from every goal in reverse: any floor tile the box can't be pulled to
+     * is dead, such as a corner or a stretch along a wall without goals.
+     * Pushing a box onto a dead square makes the level unsolvable, so
+     * game play and search code can use this to reject such pushes.
+     *
+     * @param x The X coordinate of the tile (0-based, like getTileData)
+     * @param y The Y coordinate of the tile (0-based, like getTileData)
+     * @return True if the tile is dead, false if it isn't, is out of range,
+     * or the level hasn't been validated
+     */
+    bool isDeadSquare( Uint32 x, Uint32 y ) const;
+
+    /*!
+     * @brief Returns true if a box can never move again and is part of a freeze deadlock
+     *
+     * The box is frozen if walls, dead squares and other frozen boxes block
+     * it both vertically and horizontally, and it is a deadlock if it or any
+     * box frozen with it is off goal. Only the neighbourhood of the box is
+     * looked at, see CompiledLevel::isFreezeDeadlock. The same check runs
+     * after every push and is reported through LevelListener::onLevelDeadlocked.
+     *
+     * @param x The X coordinate of the box (0-based, like getTileData)
+     * @param y The Y coordinate of the box (0-based, like getTileData)
+     * @return True if the box is frozen in a deadlock, false if it isn't,
+     * there is no box, or the level hasn't been validated
+     */
+    bool isFreezeDeadlock( Uint32 x, Uint32 y ) const;
+
+    /*!
+     * @brief Sets a database of deadlocked patterns to check pushes against
+     *
+     * After every push, the windows around the pushed box are looked up and
+     * a match is reported through LevelListener::onLevelDeadlocked, like a
+     * freeze deadlock. Solvers searching this level use the database too.
+     * Copies and branches of the level share the database.
+     *
+     * @param database The database, which must outlive the level. Pass 0 to
+     * stop using a database
+     */
+    void setPatternDatabase( const PatternDatabase* database );
+
+    /*!
+     * @brief Returns the database of deadlocked patterns, or 0 if none is set
+     */
+    const PatternDatabase* getPatternDatabase( void ) const;
+
     /*!
      * @brief Undoes the last move
      * @note If no undo data exists, this method will silently fail
@@ -299,27 +476,355 @@ public:
      */
     void redo( void );
 
+    /*!
+     * @brief Jumps to any move in the undo/redo history
+     *
+     * The nearest snapshot of the history is restored and the remaining
+     * moves are replayed, so this never replays more moves than the
+     * snapshot interval. If the target is closer to the current move,
+     * moves are undone or redone directly instead.
+     *
+     * @note If the move doesn't exist, this method will silently fail
+     *
+     * @param move The number of moves from the start of the level (0 is the
+     * initial state, getHistorySize() is the last recorded move)
+     */
+    void seekToMove( Uint32 move );
+
+    /*!
+     * @brief Returns the number of moves made to reach the current state
+     *
+     * This is the position in the history, so undoing a move decreases it.
+     */
+    Uint32 getMoveCount( void ) const;
+
+    /*!
+     * @brief Returns the number of moves in the history, including moves that can be redone
+     */
+    Uint32 getHistorySize( void ) const;
+
+    /*!
+     * @brief Sets how many moves apart history snapshots are taken
+     *
+     * Smaller intervals make seeking faster at the cost of memory. Changing
+     * the interval replays the entire history once to rebuild the snapshots.
+     *
+     * @param interval The number of moves between two snapshots. The default
+     * is MoveHistory::DEFAULT_SNAPSHOT_INTERVAL
+     */
+    void setSnapshotInterval( Uint32 interval );
+
+    /*!
+     * @brief Resets the level to its initial state and erases all undo data
+     */
+    void reset( void );
+
+    /*!
+     * @brief Checks if every box of the level is placed on a goal
+     *
+     * The number of boxes on goals is updated incrementally on every move,
+     * undo and redo, so this check doesn't depend on the size of the level.
+     *
+     * @return True if the level is solved, false if otherwise
+     */
+    bool isSolved( void ) const;
+
+    /*!
+     * @brief Checks if every box is placed on a goal in a position of this level
+     *
+     * @param state A position saved from this level or reached with replayMoves
+     * @return True if the position is solved, false if otherwise
+     */
+    bool isSolved( const LevelState& state ) const;
+
+    /*!
+     * @brief Returns a 64-bit hash identifying the current position
+     *
+     * The hash covers the set of boxes and the region the player can
+     * reach, so two positions which only differ in where the player is
+     * standing inside the same region hash to the same value. This makes
+     * it suitable as a key for transposition tables and duplicate position
+     * detection.
+     *
+     * The box part of the hash is updated with XORs on every push and undo.
+     * The player region only changes when a box is moved, so it is
+     * recomputed lazily the first time the hash is requested after a push.
+     *
+     * @return The hash of the current position, or 0 if the level hasn't
+     * been validated
+     */
+    Uint64 getHash( void ) const;
+
+    /*!
+     * @brief Returns a 64-bit hash of the box positions only
+     *
+     * This is always up to date and never requires any work.
+     *
+     * @return The hash of all box positions
+     */
+    Uint64 getBoxHash( void ) const;
+
+    /*!
+     * @brief Registers a listener to receive events from this level
+     *
+     * @note The listener is not owned by the level and must be removed again
+     * before it is destroyed.
+     *
+     * @param listener The listener to register
+     */
+    void addListener( LevelListener* listener );
+
+    /*!
+     * @brief Unregisters a listener
+     *
+     * @param listener The listener to remove
+     */
+    void removeListener( LevelListener* listener );
+
+    /*!
+     * @brief Creates a lightweight copy of the level at the current position
+     *
+     * The branch shares all static data and the pattern database with this
+     * level and starts with an empty move history, so creating one only
+     * copies the box and player positions. Use it to try out move sequences
+     * without touching this level. Listeners are not copied.
+     *
+     * @return The new level, already validated if this level is valid
+     */
+    Level createBranch( void ) const;
+
+    /*!
+     * @brief Saves the box and player positions of the current position
+     *
+     * @param state The object to save the position to
+     */
+    void saveState( LevelState& state ) const;
+
+    /*!
+     * @brief Restores a position previously saved with saveState
+     *
+     * The state must have been saved from this level or from a level sharing
+     * its static data (see createBranch). The restored position becomes the
+     * new initial state of the level and all undo data is erased.
+     *
+     * @note If the level hasn't been validated, this method will silently fail
+     *
+     * @param state The state to restore
+     */
+    void restoreState( const LevelState& state );
+
+    /*!
+     * @brief Returns the cell graph of the level
+     *
+     * The graph is built once by validateLevel and shared between all copies
+     * and branches of the level. Before the level is validated, it has no
+     * cells.
+     */
+    const CompiledLevel& getCompiledLevel( void ) const;
+
 private:
 
+    /*!
+     * @brief The parts of a level which don't change during game play
+     *
+     * They are shared between copies of a level and only copied when
+     * modified (see getWritableStaticData).
+     */
+    struct StaticData
+    {
+        StaticData( void );
+
+        std::map<std::string, std::string> metaData;
+        std::vector<std::string> headerData;
+        std::vector<std::string> notes;
+        std::string levelName;
+
+        // static layer, stored row-major with a border of walls around it.
+        // Only holds walls, goals and floor
+        std::vector<char> tiles;
+        Bitfield goals;
+        Uint32 sizeX;
+        Uint32 sizeY;
+        Uint32 stride;
+        Int32 directionOffset[4];
+
+        Uint32 playerCount;
+        Uint32 boxCount;
+
+        CompiledLevel compiledLevel;
+
+        // tiles a box can never be pushed off to a goal from, see isDeadSquare
+        Bitfield deadSquares;
+    };
+
+    /*!
+     * @brief Directions the player can move in
+     *
+     * The order matches the offsets stored in StaticData::directionOffset. Opposite
+     * directions only differ in their lowest bit.
+     */
+    enum Direction
+    {
+        DIRECTION_UP = 0,
+        DIRECTION_DOWN = 1,
+        DIRECTION_LEFT = 2,
+        DIRECTION_RIGHT = 3
+    };
+
+    /*!
+     * @brief Constructs a branch at the given position, see createBranch
+     *
+     * Unlike the default constructor this doesn't allocate static data of
+     * its own, so a branch only costs copying the position.
+     */
+    Level( const std::shared_ptr<StaticData>& staticData, const LevelState& state );
+
     /*!
      * @brief Moves the player and updates all tiles
      *
-     * @param newX The new x position the player should have
-     * @param newY The new y position the player should have
+     * @param direction The direction to move in
+     * @param isRedo If true, the move is replayed from the history instead
+     * of being recorded
      * @return Returns true if the move was successful, false if otherwise
      */
-    bool movePlayer( char direction );
+    bool movePlayer( Direction direction, bool isRedo = false );
 
-    std::map<std::string, std::string> m_MetaData;
-    std::vector< std::vector<char> > m_LevelArray;
-    std::vector<std::string> m_HeaderData;
-    std::vector<std::string> m_Notes;
-    std::vector<char> m_UndoData;
-    std::string m_LevelName;
+    /*!
+     * @brief Resizes the tile layers so they can hold a level of the given size
+     *
+     * Existing tiles are preserved, new tiles are filled with floor. The
+     * layers always have a border of walls one tile thick around the level.
+     */
+    void resizeTileBuffer( Uint32 sizeX, Uint32 sizeY );
+
+    /*!
+     * @brief Converts level coordinates (0-based) into an index into the tile layers
+     */
+    Uint32 getTileIndex( Uint32 x, Uint32 y ) const;
+
+    /*!
+     * @brief Combines the static and dynamic layers into a tile character
+     */
+    char composeTile( Uint32 index ) const;
+
+    /*!
+     * @brief Rebuilds m_TileBuffer from the static and dynamic layers if it is out of date
+     */
+    void updateTileBuffer( void ) const;
+
+    /*!
+     * @brief Returns the static data for modification
+     *
+     * If the static data is shared with other levels, this level receives
+     * its own copy first.
+     */
+    StaticData& getWritableStaticData( void );
+
+    /*!
+     * @brief Restores a history snapshot
+     *
+     * @param snapshot The snapshot to restore
+     * @param moveCount The move count the snapshot was taken at
+     */
+    void restoreSnapshot( const LevelState& snapshot, Uint32 moveCount );
+
+    /*!
+     * @brief Returns true if every box is placed on a goal
+     *
+     * This is a single AND/compare pass over the box and goal words. It's
+     * used to initialise and verify the incrementally updated counters.
+     */
+    bool allBoxesOnGoals( void ) const;
+
+    /*!
+     * @brief Updates the boxes-on-goals counter and the box hash after a box was moved
+     */
+    void updateBoxCounters( Uint32 from, Uint32 to );
+
+    /*!
+     * @brief Finds the lowest tile index the player can reach without pushing boxes
+     *
+     * This is used to normalise the player position when hashing.
+     */
+    Uint32 findNormalisedPlayerIndex( void ) const;
+
+    /*!
+     * @brief Finds the shortest walk between two cells of the compiled level
+     *
+     * Boxes block the walk. One box can be treated as if it was moved, which
+     * is used to plan walks while dragging a box.
+     *
+     * Afterwards, m_PathMarks[cell] == m_PathMark for every cell visited,
+     * which is every cell reachable from start if the target wasn't found.
+     *
+     * @param start The cell to start from
+     * @param target The cell to walk to, or CompiledLevel::NO_CELL to only
+     * mark the reachable cells
+     * @param movedBoxFrom The cell of the box to move, or CompiledLevel::NO_CELL
+     * @param movedBoxTo The cell the box is moved to, or CompiledLevel::NO_CELL
+     * @param moves The walk is appended to this in LURD notation (lower case)
+     * @return True if the target can be reached, false if otherwise
+     */
+    bool findWalk( Uint32 start, Uint32 target, Uint32 movedBoxFrom, Uint32 movedBoxTo, std::string& moves ) const;
 
-    Uint32 m_PlayerX;
-    Uint32 m_PlayerY;
-    Uint32 m_UndoDataIndex;
+    /*!
+     * @brief Reports changed tiles to all listeners
+     *
+     * @param indices The tile indices of the changed tiles
+     * @param count The number of changed tiles (at most 3)
+     */
+    void notifyTilesChanged( const Uint32* indices, Uint32 count ) const;
+
+    /*!
+     * @brief Tells all listeners that the entire position changed
+     */
+    void notifyLevelChanged( void ) const;
+
+    /*!
+     * @brief Returns true if the box on a tile is part of a freeze deadlock, see isFreezeDeadlock
+     */
+    bool isFrozenBox( Uint32 index ) const;
+
+    /*!
+     * @brief Returns true if the box on a tile is part of a deadlocked pattern of the pattern database
+     */
+    bool isPatternDeadlock( Uint32 index ) const;
+
+    std::shared_ptr<StaticData> m_StaticData;
+    LevelState m_State;
+    MoveHistory m_History;
+
+    // scratch buffers for findPath and findWalk. Marks are compared against a running
+    // counter, so they never need clearing
+    mutable std::vector<Uint32> m_PathQueue;
+    mutable std::vector<Uint32> m_PathMarks;
+    mutable std::vector<Uint8> m_PathDirections;
+    mutable Uint32 m_PathMark;
+    std::string m_PathMoves;
+
+    // scratch buffers for findBoxPath
+    mutable std::vector<Uint32> m_PushQueue;
+    mutable std::vector<Uint32> m_PushMarks;
+    mutable std::vector<Uint32> m_PushParents;
+    mutable Uint32 m_PushMark;
+
+    // the normalised player position is only recomputed after a push
+    mutable Uint32 m_NormalisedPlayerIndex;
+    mutable bool m_NormalisedPlayerIndexIsDirty;
+    mutable std::vector<Uint32> m_FloodFillStack;
+    mutable std::vector<Uint32> m_FloodFillMarks;
+    mutable Uint32 m_FloodFillMark;
+
+    // character grids derived from the layers for rendering, rebuilt lazily
+    mutable std::vector<char> m_TileBuffer;
+    mutable bool m_TileBufferIsDirty;
+    mutable std::vector< std::vector<char> > m_TileDataView;
+    mutable bool m_TileDataViewIsDirty;
+
+    std::vector<LevelListener*> m_Listeners;
+    const PatternDatabase* m_PatternDatabase;
+
+    Uint32 m_HistoryIndex;
 
     bool m_IsLevelValid;
 };
@@ -0,0 +1,109 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Level listener
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_LEVEL_LISTENER_HPP__
+#define __CHOCOBUN_CORE_LEVEL_LISTENER_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+
+namespace Chocobun {
+
+// --------------------------------------------------------------
+// forward declarations
+
+class Level;
+
+/*!
+ * @brief Describes a single tile which was changed by a move
+ */
+struct TileChange
+{
+    Uint32 x;   //!< X coordinate, 0-based like Level::getTileData
+    Uint32 y;   //!< Y coordinate, 0-based like Level::getTileData
+    char tile;  //!< The new tile character
+};
+
+/*!
+ * @brief Interface for receiving events from a level
+ *
+ * Inherit from this class and override the events you are interested in,
+ * then register it with Level::addListener or Collection::addListener.
+ * All events have empty default implementations.
+ */
+class LevelListener
+{
+public:
+
+    /*!
+     * @brief Destructor
+     */
+    virtual ~LevelListener( void ) {}
+
+    /*!
+     * @brief Called when a move places the last box onto a goal
+     *
+     * @param level The level that was solved
+     */
+    virtual void onLevelSolved( const Level& level ) {}
+
+    /*!
+     * @brief Called when a push freezes a box in a deadlock or completes a deadlocked pattern
+     *
+     * The level can't be solved anymore without undoing moves. See
+     * Level::isFreezeDeadlock and Level::setPatternDatabase.
+     *
+     * @param level The level which became unsolvable
+     * @param x The X coordinate of the box pushed (0-based, like Level::getTileData)
+     * @param y The Y coordinate of the box pushed (0-based, like Level::getTileData)
+     */
+    virtual void onLevelDeadlocked( const Level& level, Uint32 x, Uint32 y ) {}
+
+    /*!
+     * @brief Called after a move, undo or redo changed some tiles
+     *
+     * A move changes at most three tiles: the tile the player left, the tile
+     * the player entered, and the tile a box was pushed onto (or pulled from,
+     * when undoing). Only these are reported, so front-ends can redraw or
+     * transmit just the difference.
+     *
+     * @param level The level which changed
+     * @param changes The changed tiles
+     * @param count The number of changed tiles (2 or 3)
+     */
+    virtual void onTilesChanged( const Level& level, const TileChange* changes, Uint32 count ) {}
+
+    /*!
+     * @brief Called when the whole position of a level was replaced
+     *
+     * This happens when a history snapshot or a saved state is restored,
+     * so any tile may have changed and the level should be redrawn entirely.
+     *
+     * @param level The level which changed
+     */
+    virtual void onLevelChanged( const Level& level ) {}
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_LEVEL_LISTENER_HPP__
@@ -0,0 +1,64 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Level state
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_LEVEL_STATE_HPP__
+#define __CHOCOBUN_CORE_LEVEL_STATE_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/Bitfield.hpp>
+
+namespace Chocobun {
+
+/*!
+ * @brief The dynamic part of a level: where the boxes and the player are
+ *
+ * Everything else about a level (walls, goals, meta data, notes) never
+ * changes during game play, so a LevelState is all that's needed to save
+ * and restore a position. It is small (one bit per tile plus a few
+ * counters) and cheap to copy, which makes it suitable for lookahead and
+ * for storing many positions at once.
+ *
+ * A LevelState is only meaningful for the level it was saved from.
+ *
+ * @see Level::saveState, Level::restoreState
+ */
+struct LevelState
+{
+    LevelState( void ) : playerIndex( 0 ), boxesOnGoals( 0 ), boxHash( 0 ) {}
+
+    Bitfield boxes;
+    Uint32 playerIndex;
+    Uint32 boxesOnGoals;
+    Uint64 boxHash;
+
+    bool operator==( const LevelState& other ) const
+    {
+        return boxHash == other.boxHash && playerIndex == other.playerIndex && boxes == other.boxes;
+    }
+    bool operator!=( const LevelState& other ) const { return !(*this == other); }
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_LEVEL_STATE_HPP__
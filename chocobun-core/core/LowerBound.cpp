@@ -0,0 +1,200 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Lower bound
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/LowerBound.hpp>
+#include <core/CompiledLevel.hpp>
+
+#include <algorithm>
+
+namespace Chocobun {
+
+namespace {
+
+const Uint32 NO_ROW = 0xFFFFFFFF;
+const Uint32 NO_GOAL = 0xFFFFFFFF;
+
+// a goal a box can't reach. Larger than any sum of real push distances
+const Int64 INFINITE_COST = Int64(1) << 32;
+
+// larger than any slack during the search of an augmenting path
+const Int64 INFINITE_SLACK = Int64(1) << 62;
+
+} // namespace
+
+// --------------------------------------------------------------
+LowerBound::LowerBound( const SearchSpace& space, Solver::Heuristic heuristic, bool isPulling ) :
+    m_Space( space ),
+    m_CompiledLevel( space.getCompiledLevel() ),
+    m_Heuristic( heuristic ),
+    m_IsPulling( isPulling ),
+    m_BoxCount( space.getBoxCount() ),
+    m_GoalCount( isPulling ? space.getBoxCount() : static_cast<Uint32>( space.getCompiledLevel().getGoalCells().size() ) )
+{
+}
+
+// --------------------------------------------------------------
+LowerBound::~LowerBound( void )
+{
+}
+
+// --------------------------------------------------------------
+Uint32 LowerBound::compute( const Uint16* boxes, State& state )
+{
+    if( m_Heuristic == Solver::HEURISTIC_GREEDY || m_BoxCount > m_GoalCount )
+        return this->getGreedyBound( boxes );
+
+    // rows are assigned one by one. Unassigned goals are never visited by
+    // assignRow until they are assigned, so their potentials all stay 0
+    state.rowPotentials.assign( m_GoalCount, 0 );
+    state.goalPotentials.assign( m_GoalCount, 0 );
+    state.rowGoals.assign( m_GoalCount, NO_GOAL );
+    state.goalRows.assign( m_GoalCount, NO_ROW );
+    for( Uint32 row = 0; row != m_GoalCount; ++row )
+        this->assignRow( boxes, row, state );
+    return this->getBound( boxes, state );
+}
+
+// --------------------------------------------------------------
+Uint32 LowerBound::update( const State& parent, const Uint16* boxes, Uint32 fromRow, Uint32 toRow, State& state )
+{
+    if( m_Heuristic == Solver::HEURISTIC_GREEDY || m_BoxCount > m_GoalCount )
+        return this->getGreedyBound( boxes );
+
+    // move the row of the pushed box to where the box is sorted to now
+    state = parent;
+    Uint32 first = std::min( fromRow, toRow ), last = std::max( fromRow, toRow );
+    if( fromRow < toRow )
+    {
+        std::rotate( state.rowPotentials.begin() + fromRow, state.rowPotentials.begin() + fromRow + 1, state.rowPotentials.begin() + toRow + 1 );
+        std::rotate( state.rowGoals.begin() + fromRow, state.rowGoals.begin() + fromRow + 1, state.rowGoals.begin() + toRow + 1 );
+    }else
+    {
+        std::rotate( state.rowPotentials.begin() + toRow, state.rowPotentials.begin() + fromRow, state.rowPotentials.begin() + fromRow + 1 );
+        std::rotate( state.rowGoals.begin() + toRow, state.rowGoals.begin() + fromRow, state.rowGoals.begin() + fromRow + 1 );
+    }
+    for( Uint32 row = first; row <= last; ++row )
+        state.goalRows[state.rowGoals[row]] = row;
+
+    // only the costs of the pushed box changed, so the assignment is
+    // optimal again once it is reassigned
+    state.goalRows[state.rowGoals[toRow]] = NO_ROW;
+    state.rowGoals[toRow] = NO_GOAL;
+    this->assignRow( boxes, toRow, state );
+    return this->getBound( boxes, state );
+}
+
+// --------------------------------------------------------------
+Uint32 LowerBound::getGreedyBound( const Uint16* boxes ) const
+{
+    return m_IsPulling ? m_Space.getPullLowerBound( boxes ) : m_Space.getLowerBound( boxes );
+}
+
+// --------------------------------------------------------------
+Int64 LowerBound::getCost( const Uint16* boxes, Uint32 row, Uint32 goal ) const
+{
+    if( row >= m_BoxCount ) return 0;
+    Uint16 distance = ( m_IsPulling ? m_Space.getPullDistance( goal, boxes[row] ) : m_CompiledLevel.getPushDistance( goal, boxes[row] ) );
+    return distance == CompiledLevel::NO_DISTANCE ? INFINITE_COST : distance;
+}
+
+// --------------------------------------------------------------
+void LowerBound::assignRow( const Uint16* boxes, Uint32 row, State& state )
+{
+    Int64* rowPotentials = state.rowPotentials.data();
+    Int64* goalPotentials = state.goalPotentials.data();
+    m_MinSlack.assign( m_GoalCount, INFINITE_SLACK );
+    m_Previous.assign( m_GoalCount, NO_GOAL );
+    m_IsVisited.assign( m_GoalCount, false );
+
+    // the costs of the row may have changed, so its potential is made
+    // feasible again. Some goal is tight afterwards
+    Int64 potential = INFINITE_SLACK;
+    for( Uint32 goal = 0; goal != m_GoalCount; ++goal )
+        potential = std::min( potential, this->getCost( boxes, row, goal ) - goalPotentials[goal] );
+    rowPotentials[row] = potential;
+
+    // Dijkstra over the goals on the slacks, which are never negative.
+    // Each step visits the goal with the least slack and continues with
+    // the row assigned to it, until an unassigned goal is reached
+    Uint32 current = row;
+    Uint32 goal = NO_GOAL;
+    for(;;)
+    {
+        Int64 delta = INFINITE_SLACK;
+        Uint32 next = NO_GOAL;
+        for( Uint32 j = 0; j != m_GoalCount; ++j )
+        {
+            if( m_IsVisited[j] ) continue;
+            Int64 slack = this->getCost( boxes, current, j ) - rowPotentials[current] - goalPotentials[j];
+            if( slack < m_MinSlack[j] )
+            {
+                m_MinSlack[j] = slack;
+                m_Previous[j] = goal;
+            }
+            if( m_MinSlack[j] < delta )
+            {
+                delta = m_MinSlack[j];
+                next = j;
+            }
+        }
+
+        // shift the potentials so the path to the next goal is tight
+        rowPotentials[row] += delta;
+        for( Uint32 j = 0; j != m_GoalCount; ++j )
+        {
+            if( m_IsVisited[j] )
+            {
+                rowPotentials[state.goalRows[j]] += delta;
+                goalPotentials[j] -= delta;
+            }else
+                m_MinSlack[j] -= delta;
+        }
+
+        m_IsVisited[next] = true;
+        goal = next;
+        if( state.goalRows[goal] == NO_ROW ) break;
+        current = state.goalRows[goal];
+    }
+
+    // flip the assignments along the path
+    while( goal != NO_GOAL )
+    {
+        Uint32 previous = m_Previous[goal];
+        Uint32 assignedRow = ( previous == NO_GOAL ? row : state.goalRows[previous] );
+        state.goalRows[goal] = assignedRow;
+        state.rowGoals[assignedRow] = goal;
+        goal = previous;
+    }
+}
+
+// --------------------------------------------------------------
+Uint32 LowerBound::getBound( const Uint16* boxes, const State& state ) const
+{
+    Int64 bound = 0;
+    for( Uint32 row = 0; row != m_BoxCount; ++row )
+        bound += this->getCost( boxes, row, state.rowGoals[row] );
+    return bound >= INFINITE_COST ? SearchSpace::NO_BOUND : static_cast<Uint32>( bound );
+}
+
+} // namespace Chocobun
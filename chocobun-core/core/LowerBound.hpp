@@ -0,0 +1,163 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Lower bound
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_LOWER_BOUND_HPP__
+#define __CHOCOBUN_CORE_LOWER_BOUND_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/SearchSpace.hpp>
+#include <core/Solver.hpp>
+
+#include <vector>
+
+namespace Chocobun {
+
+/*!
+ * @brief Computes lower bounds of the pushes needed to solve positions
+ *
+ * With Solver::HEURISTIC_GREEDY this is SearchSpace::getLowerBound. With
+ * Solver::HEURISTIC_MATCHING every box is assigned a goal of its own so
+ * that the sum of the push distances is minimal, which is found with the
+ * Hungarian method.
+ *
+ * Solving the assignment takes O(n^3) time for n goals. A push only moves
+ * a single box though, so the assignment of a position is derived from the
+ * one of the position before the push: the pushed box is unassigned, and
+ * reassigned along one shortest augmenting path, which takes O(n^2) time.
+ * To keep the problem square, goals which don't get a box are assigned to
+ * dummy boxes at no cost.
+ *
+ * The bound is consistent, because a push changes the push distances of a
+ * box by at most one.
+ *
+ * Searches over pulls (see SearchSpace::generatePulls) need a bound of the
+ * pulls back to the start position instead. It is found the same way, with
+ * the start box cells taking the place of the goals and pull distances
+ * taking the place of push distances.
+ *
+ * Holds buffers, so every thread needs its own instance.
+ */
+class LowerBound
+{
+public:
+
+    /*!
+     * @brief The assignment of a position
+     *
+     * Rows are the boxes in the order of the sorted box array, followed by
+     * the dummy boxes. Empty with Solver::HEURISTIC_GREEDY.
+     */
+    struct State
+    {
+        std::vector<Int64> rowPotentials;
+        std::vector<Int64> goalPotentials;
+        std::vector<Uint32> rowGoals;
+        std::vector<Uint32> goalRows;
+    };
+
+    /*!
+     * @brief Constructor
+     *
+     * @param space The search space positions belong to
+     * @param heuristic The lower bound to compute
+     * @param isPulling True to bound the pulls back to the start position
+     * rather than the pushes to the goals
+     */
+    LowerBound( const SearchSpace& space, Solver::Heuristic heuristic, bool isPulling = false );
+
+    /*!
+     * @brief Destructor
+     */
+    ~LowerBound( void );
+
+    /*!
+     * @brief Returns the lower bound computed
+     */
+    Solver::Heuristic getHeuristic( void ) const { return m_Heuristic; }
+
+    /*!
+     * @brief Computes the lower bound of a position from scratch
+     *
+     * @param boxes The sorted box cells
+     * @param state Receives the assignment
+     * @return The lower bound, or SearchSpace::NO_BOUND if the boxes can't
+     * all be pushed to different goals (or pulled to different start box cells)
+     */
+    Uint32 compute( const Uint16* boxes, State& state );
+
+    /*!
+     * @brief Computes the lower bound of the position after a push (or pull)
+     *
+     * @param parent The assignment of the position before the push
+     * @param boxes The sorted box cells after the push
+     * @param fromRow The position of the pushed box in the box array before the push
+     * @param toRow The position of the pushed box in the box array after
+     * the push, as returned by SearchSpace::applyPush
+     * @param state Receives the assignment. Must not be parent
+     * @return The lower bound, or SearchSpace::NO_BOUND if the boxes can't
+     * all be pushed to different goals (or pulled to different start box cells)
+     */
+    Uint32 update( const State& parent, const Uint16* boxes, Uint32 fromRow, Uint32 toRow, State& state );
+
+private:
+
+    /*!
+     * @brief Returns SearchSpace::getLowerBound, or SearchSpace::getPullLowerBound when pulling
+     */
+    Uint32 getGreedyBound( const Uint16* boxes ) const;
+
+    /*!
+     * @brief Returns the cost of assigning a row to a goal
+     */
+    Int64 getCost( const Uint16* boxes, Uint32 row, Uint32 goal ) const;
+
+    /*!
+     * @brief Assigns an unassigned row along a shortest augmenting path
+     *
+     * The potentials must be feasible for every row, and tight for every
+     * assigned one. Exactly one goal must be unassigned.
+     */
+    void assignRow( const Uint16* boxes, Uint32 row, State& state );
+
+    /*!
+     * @brief Sums up the costs of the assignment of the real boxes
+     */
+    Uint32 getBound( const Uint16* boxes, const State& state ) const;
+
+    const SearchSpace& m_Space;
+    const CompiledLevel& m_CompiledLevel;
+    Solver::Heuristic m_Heuristic;
+    bool m_IsPulling;
+    Uint32 m_BoxCount;
+    Uint32 m_GoalCount;
+
+    // buffers of assignRow
+    std::vector<Int64> m_MinSlack;
+    std::vector<Uint32> m_Previous;
+    std::vector<bool> m_IsVisited;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_LOWER_BOUND_HPP__
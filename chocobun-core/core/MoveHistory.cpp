@@ -0,0 +1,130 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Move history
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/MoveHistory.hpp>
+#include <core/Exception.hpp>
+
+namespace Chocobun {
+
+// --------------------------------------------------------------
+MoveHistory::MoveHistory( void ) :
+    m_Size( 0 ),
+    m_SnapshotInterval( DEFAULT_SNAPSHOT_INTERVAL )
+{
+}
+
+// --------------------------------------------------------------
+MoveHistory::~MoveHistory( void )
+{
+}
+
+// --------------------------------------------------------------
+void MoveHistory::clear( void )
+{
+    m_Words.clear();
+    m_Snapshots.clear();
+    m_Size = 0;
+}
+
+// --------------------------------------------------------------
+Uint32 MoveHistory::size( void ) const
+{
+    return m_Size;
+}
+
+// --------------------------------------------------------------
+void MoveHistory::push( Uint8 code )
+{
+    Uint32 shift = (m_Size % MOVES_PER_WORD) * 3;
+    if( shift == 0 )
+        m_Words.push_back( 0 );
+    m_Words.back() |= Uint64(code & 7) << shift;
+    ++m_Size;
+}
+
+// --------------------------------------------------------------
+Uint8 MoveHistory::get( Uint32 index ) const
+{
+    return static_cast<Uint8>( (m_Words[index / MOVES_PER_WORD] >> ((index % MOVES_PER_WORD) * 3)) & 7 );
+}
+
+// --------------------------------------------------------------
+void MoveHistory::truncate( Uint32 size )
+{
+    if( size >= m_Size ) return;
+
+    // drop whole words, then clear the unused bits of the last one
+    m_Words.resize( (size + MOVES_PER_WORD - 1) / MOVES_PER_WORD );
+    Uint32 shift = (size % MOVES_PER_WORD) * 3;
+    if( shift )
+        m_Words.back() &= (Uint64(1) << shift) - 1;
+    m_Size = size;
+
+    // snapshots taken after the last remaining move are no longer valid
+    Uint32 snapshotCount = size / m_SnapshotInterval + 1;
+    if( m_Snapshots.size() > snapshotCount )
+        m_Snapshots.resize( snapshotCount );
+}
+
+// --------------------------------------------------------------
+void MoveHistory::setSnapshotInterval( Uint32 interval )
+{
+    if( interval == 0 )
+        throw Exception( "[MoveHistory::setSnapshotInterval] snapshot interval must be at least 1" );
+    m_SnapshotInterval = interval;
+    if( m_Snapshots.size() > 1 )
+        m_Snapshots.resize( 1 );
+}
+
+// --------------------------------------------------------------
+Uint32 MoveHistory::getSnapshotInterval( void ) const
+{
+    return m_SnapshotInterval;
+}
+
+// --------------------------------------------------------------
+bool MoveHistory::needsSnapshot( Uint32 moveCount ) const
+{
+    return ( moveCount % m_SnapshotInterval == 0 &&
+             moveCount / m_SnapshotInterval == m_Snapshots.size() );
+}
+
+// --------------------------------------------------------------
+void MoveHistory::addSnapshot( const LevelState& state )
+{
+    m_Snapshots.push_back( state );
+}
+
+// --------------------------------------------------------------
+const LevelState* MoveHistory::findSnapshot( Uint32 moveCount, Uint32& snapshotMoveCount ) const
+{
+    if( m_Snapshots.empty() ) return 0;
+    Uint32 i = moveCount / m_SnapshotInterval;
+    if( i >= m_Snapshots.size() )
+        i = m_Snapshots.size() - 1;
+    snapshotMoveCount = i * m_SnapshotInterval;
+    return &m_Snapshots[i];
+}
+
+} // namespace Chocobun
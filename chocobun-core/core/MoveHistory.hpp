@@ -0,0 +1,156 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Move history
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_MOVE_HISTORY_HPP__
+#define __CHOCOBUN_CORE_MOVE_HISTORY_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/LevelState.hpp>
+
+#include <vector>
+
+namespace Chocobun {
+
+/*!
+ * @brief Stores the moves made on a level for undo, redo and seeking
+ *
+ * Each move is encoded in 3 bits (2 bits for the direction, 1 bit flagging
+ * a push) and packed 21 moves to a 64-bit word, which is roughly a third of
+ * the memory one character per move requires.
+ *
+ * Additionally, a snapshot of the level's state is kept every few moves
+ * (see setSnapshotInterval). Seeking to any move restores the nearest
+ * snapshot before it and replays at most one interval of moves.
+ */
+class MoveHistory
+{
+public:
+
+    /*!
+     * @brief Flag set in a move code if the move pushed a box
+     */
+    static const Uint8 PUSH_FLAG = 4;
+
+    /*!
+     * @brief Number of moves between two snapshots, unless configured otherwise
+     */
+    static const Uint32 DEFAULT_SNAPSHOT_INTERVAL = 1024;
+
+    /*!
+     * @brief Constructor
+     */
+    MoveHistory( void );
+
+    /*!
+     * @brief Destructor
+     */
+    ~MoveHistory( void );
+
+    /*!
+     * @brief Erases all moves and snapshots
+     */
+    void clear( void );
+
+    /*!
+     * @brief Returns the number of moves stored
+     */
+    Uint32 size( void ) const;
+
+    /*!
+     * @brief Appends a move
+     *
+     * @param code The direction of the move (0-3), combined with PUSH_FLAG
+     * if a box was pushed
+     */
+    void push( Uint8 code );
+
+    /*!
+     * @brief Returns the code of a move
+     *
+     * @param index The index of the move (0 is the first move)
+     */
+    Uint8 get( Uint32 index ) const;
+
+    /*!
+     * @brief Removes all moves (and their snapshots) after the given move count
+     *
+     * @param size The number of moves to keep
+     */
+    void truncate( Uint32 size );
+
+    /*!
+     * @brief Sets the number of moves between two snapshots
+     *
+     * @note This removes all snapshots except for the initial one. They have
+     * to be added again by replaying the moves.
+     *
+     * @param interval The number of moves between snapshots. Must be at least 1
+     */
+    void setSnapshotInterval( Uint32 interval );
+
+    /*!
+     * @brief Returns the number of moves between two snapshots
+     */
+    Uint32 getSnapshotInterval( void ) const;
+
+    /*!
+     * @brief Checks if a snapshot should be stored after the given move count
+     *
+     * @param moveCount The number of moves made (after the move)
+     * @return True if moveCount is on a snapshot boundary and there isn't
+     * a snapshot for it yet
+     */
+    bool needsSnapshot( Uint32 moveCount ) const;
+
+    /*!
+     * @brief Stores a snapshot for the next snapshot boundary
+     *
+     * Snapshots must be added in order, the first one being the initial
+     * state of the level (move count 0).
+     */
+    void addSnapshot( const LevelState& state );
+
+    /*!
+     * @brief Finds the closest snapshot at or before a move count
+     *
+     * @param moveCount The move count to search for
+     * @param snapshotMoveCount Receives the move count the snapshot was taken at
+     * @return The snapshot, or 0 if there are no snapshots
+     */
+    const LevelState* findSnapshot( Uint32 moveCount, Uint32& snapshotMoveCount ) const;
+
+private:
+
+    // 21 moves of 3 bits each fit into one 64-bit word
+    static const Uint32 MOVES_PER_WORD = 21;
+
+    std::vector<Uint64> m_Words;
+    std::vector<LevelState> m_Snapshots;
+    Uint32 m_Size;
+    Uint32 m_SnapshotInterval;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_MOVE_HISTORY_HPP__
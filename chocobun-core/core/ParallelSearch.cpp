@@ -0,0 +1,428 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Parallel search
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/ParallelSearch.hpp>
+
+#include <algorithm>
+#include <thread>
+
+namespace Chocobun {
+
+namespace {
+
+// layout of a table entry
+const Uint64 KEY_MASK = 0xFFFFFFFF00000000ULL;
+const Uint32 ITERATION_SHIFT = 16;
+const Uint64 G_MASK = 0xFFFF;
+
+// number of shards, as a power of two
+const Uint32 SHARD_BITS = 6;
+
+// expansions counted per thread before the shared counter and the clock are checked
+const Uint64 LIMIT_CHECK_INTERVAL = 256;
+
+} // namespace
+
+// --------------------------------------------------------------
+SharedTable::SharedTable( Uint32 megabytes ) :
+    m_ShardBits( SHARD_BITS )
+{
+    // the entry count of every shard is rounded down to a power of two
+    Uint64 shardCount = Uint64(1) << m_ShardBits;
+    Uint64 entryCount = Uint64(megabytes) * 1024 * 1024 / sizeof(Uint64) / shardCount;
+    Uint64 shardSize = 1;
+    while( shardSize * 2 <= entryCount ) shardSize *= 2;
+
+    m_ShardMask = shardCount - 1;
+    m_EntryMask = shardSize - 1;
+    for( Uint64 i = 0; i != shardCount; ++i )
+        m_Shards.push_back( std::unique_ptr< std::atomic<Uint64>[] >( new std::atomic<Uint64>[static_cast<size_t>(shardSize)] ) );
+    this->clear();
+}
+
+// --------------------------------------------------------------
+SharedTable::~SharedTable( void )
+{
+}
+
+// --------------------------------------------------------------
+void SharedTable::clear( void )
+{
+    for( Uint32 shard = 0; shard != m_Shards.size(); ++shard )
+        for( Uint64 i = 0; i <= m_EntryMask; ++i )
+            m_Shards[shard][static_cast<size_t>(i)].store( 0, std::memory_order_relaxed );
+}
+
+// --------------------------------------------------------------
+bool SharedTable::visit( Uint64 hash, Uint32 iteration, Uint32 g )
+{
+    std::atomic<Uint64>& entry = m_Shards[static_cast<size_t>( hash & m_ShardMask )][static_cast<size_t>( (hash >> m_ShardBits) & m_EntryMask )];
+    Uint64 stamp = Uint64(iteration & 0xFFFF) << ITERATION_SHIFT;
+    Uint64 desired = (hash & KEY_MASK) | stamp | g;
+
+    // another thread may update the entry in between, in which case the
+    // comparison is repeated with what it wrote
+    Uint64 current = entry.load( std::memory_order_relaxed );
+    for(;;)
+    {
+        if( (current & ~G_MASK) == (desired & ~G_MASK) && (current & G_MASK) <= g )
+            return false;
+        if( entry.compare_exchange_weak( current, desired, std::memory_order_relaxed ) )
+            return true;
+    }
+}
+
+// --------------------------------------------------------------
+ParallelSearch::ParallelSearch( const SearchSpace& space, Solver::Heuristic heuristic, Uint32 threadCount, Uint32 tableMegabytes ) :
+    m_Space( space ),
+    m_Table( tableMegabytes ),
+    m_IdleCount( 0 ),
+    m_NodesExpanded( 0 ),
+    m_IsStopped( false ),
+    m_Threshold( 0 ),
+    m_Iteration( 0 ),
+    m_IsSolved( false ),
+    m_IsLimitReached( false ),
+    m_NodeLimit( 0 ),
+    m_HasDeadline( false ),
+    m_CancelFlag( 0 )
+{
+    for( Uint32 i = 0; i != std::max( threadCount, Uint32(1) ); ++i )
+        m_Workers.push_back( std::unique_ptr<Worker>( new Worker( space, heuristic ) ) );
+}
+
+// --------------------------------------------------------------
+ParallelSearch::~ParallelSearch( void )
+{
+}
+
+// --------------------------------------------------------------
+Solver::Result ParallelSearch::run( Uint64 nodeLimit, double timeLimit, const std::atomic<bool>* cancelFlag, std::vector<Push>& solution, Solver::Statistics& statistics )
+{
+    m_NodeLimit = nodeLimit;
+    m_CancelFlag = cancelFlag;
+    m_HasDeadline = ( timeLimit > 0 );
+    if( m_HasDeadline )
+        m_Deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( timeLimit ) );
+
+    LowerBound::State startState;
+    statistics.initialLowerBound = m_Workers[0]->lowerBound.compute( m_Space.getStartBoxes(), startState );
+    if( statistics.initialLowerBound == SearchSpace::NO_BOUND )
+        return Solver::RESULT_UNSOLVABLE;
+
+    Solver::Result result = Solver::RESULT_UNSOLVABLE;
+    Uint32 boxCount = m_Space.getBoxCount();
+    m_Threshold = statistics.initialLowerBound;
+    for(;;)
+    {
+        ++m_Iteration;
+        if( (m_Iteration & 0xFFFF) == 0 )
+            m_Table.clear();
+
+        // every push adds to g, which can't exceed the threshold for a
+        // frame, so there are at most threshold+1 frames plus the position
+        // being visited on top of them
+        Uint32 maxDepth = m_Threshold + 2;
+        for( Uint32 id = 0; id != m_Workers.size(); ++id )
+        {
+            Worker& worker = *m_Workers[id];
+            if( worker.frameCount < maxDepth )
+            {
+                worker.frames.reset( new Frame[maxDepth] );
+                worker.frameCount = maxDepth;
+                worker.boxes.resize( maxDepth * boxCount );
+                worker.children.resize( maxDepth * this->getMaxPushCount() );
+            }
+            worker.rootPath.clear();
+            worker.depth = 0;
+            worker.nextThreshold = SearchSpace::NO_BOUND;
+        }
+        m_IdleCount = 0;
+
+        // the start position becomes the first frame of the first thread,
+        // the others steal from there
+        this->visit( *m_Workers[0], 0, m_Space.getStartBoxes(), m_Space.hashBoxes( m_Space.getStartBoxes() ), 0 );
+
+        std::vector<std::thread> threads;
+        for( Uint32 id = 1; id != m_Workers.size(); ++id )
+            threads.push_back( std::thread( &ParallelSearch::work, this, id ) );
+        this->work( 0 );
+        for( Uint32 i = 0; i != threads.size(); ++i )
+            threads[i].join();
+        ++statistics.iterations;
+
+        if( m_IsSolved )
+        {
+            result = Solver::RESULT_SOLVED;
+            break;
+        }
+        if( m_IsLimitReached )
+        {
+            result = Solver::RESULT_LIMIT_REACHED;
+            break;
+        }
+        Uint32 nextThreshold = SearchSpace::NO_BOUND;
+        for( Uint32 id = 0; id != m_Workers.size(); ++id )
+            nextThreshold = std::min( nextThreshold, m_Workers[id]->nextThreshold );
+        if( nextThreshold == SearchSpace::NO_BOUND )
+            break;
+        m_Threshold = nextThreshold;
+    }
+
+    solution = m_Solution;
+    statistics.pushes = 0;
+    for( std::vector<Push>::const_iterator it = solution.begin(); it != solution.end(); ++it )
+        statistics.pushes += it->pushCount;
+
+    for( Uint32 id = 0; id != m_Workers.size(); ++id )
+    {
+        Worker& worker = *m_Workers[id];
+        statistics.nodesExpanded += worker.nodesExpanded;
+        statistics.nodesGenerated += worker.nodesGenerated;
+        statistics.duplicates += worker.duplicates;
+    }
+    return result;
+}
+
+// --------------------------------------------------------------
+void ParallelSearch::work( Uint32 id )
+{
+    Worker& worker = *m_Workers[id];
+    Uint32 boxCount = m_Space.getBoxCount();
+    while( !m_IsStopped.load( std::memory_order_relaxed ) )
+    {
+        Uint32 depth = worker.depth.load( std::memory_order_relaxed );
+        if( depth == 0 )
+        {
+            if( !this->waitForWork( id ) )
+                return;
+            continue;
+        }
+
+        // search the next push of the top frame
+        Push push;
+        if( !this->takePush( worker, depth, push ) )
+            continue;
+        const Frame& top = worker.frames[depth-1];
+        this->visit( worker, &push, &worker.boxes[(depth-1) * boxCount], top.boxHash, top.g + push.pushCount );
+    }
+}
+
+// --------------------------------------------------------------
+bool ParallelSearch::takePush( Worker& worker, Uint32 depth, Push& push )
+{
+    // claim the push before checking it is still there. A thief lowers end
+    // before checking next in the same way, so only when both go for the
+    // last push does either see the other, and the mutex decides
+    Frame& top = worker.frames[depth-1];
+    Uint32 next = top.next.load( std::memory_order_relaxed );
+    top.next.store( next+1 );
+    if( next >= top.end.load() )
+    {
+        std::lock_guard<std::mutex> lock( worker.mutex );
+        if( next >= top.end.load() )
+        {
+            // all pushes were searched or stolen, so the frame is dropped
+            worker.depth.store( depth-1, std::memory_order_relaxed );
+            return false;
+        }
+    }
+    push = worker.children[next];
+    return true;
+}
+
+// --------------------------------------------------------------
+bool ParallelSearch::waitForWork( Uint32 id )
+{
+    // only threads without work count as idle, so once all of them are,
+    // no work is left anywhere. A thread stops counting before it steals
+    m_IdleCount.fetch_add( 1 );
+    for(;;)
+    {
+        if( m_IsStopped.load( std::memory_order_relaxed ) || m_IdleCount.load() == m_Workers.size() )
+            return false;
+
+        bool hasWork = false;
+        for( Uint32 i = 0; i != m_Workers.size(); ++i )
+            hasWork |= ( m_Workers[i]->depth.load( std::memory_order_relaxed ) != 0 );
+        if( hasWork )
+        {
+            m_IdleCount.fetch_sub( 1 );
+            if( this->stealWork( id ) )
+                return true;
+            m_IdleCount.fetch_add( 1 );
+        }
+        std::this_thread::yield();
+    }
+}
+
+// --------------------------------------------------------------
+bool ParallelSearch::stealWork( Uint32 id )
+{
+    Worker& thief = *m_Workers[id];
+    Uint32 boxCount = m_Space.getBoxCount();
+    for( Uint32 i = 1; i != m_Workers.size(); ++i )
+    {
+        Worker& victim = *m_Workers[(id + i) % m_Workers.size()];
+        if( victim.depth.load( std::memory_order_relaxed ) == 0 )
+            continue;
+
+        // the victim's frames below depth stay in place while the lock is
+        // held, and were filled in before depth was raised over them
+        Push push;
+        Uint64 boxHash;
+        Uint32 g;
+        {
+            std::lock_guard<std::mutex> lock( victim.mutex );
+            Uint32 depth = victim.depth.load( std::memory_order_acquire );
+            Uint32 k = 0;
+            for( ; k != depth; ++k )
+            {
+                // back off if the victim may be taking the same push, see takePush
+                Frame& frame = victim.frames[k];
+                Uint32 end = frame.end.load( std::memory_order_relaxed );
+                if( frame.next.load( std::memory_order_relaxed ) >= end )
+                    continue;
+                frame.end.store( end-1 );
+                if( frame.next.load() < end )
+                    break;
+                frame.end.store( end );
+            }
+            if( k == depth )
+                continue;
+
+            // the path to the position after the push becomes the thief's
+            Frame& frame = victim.frames[k];
+            push = victim.children[frame.end.load( std::memory_order_relaxed )];
+            thief.rootPath = victim.rootPath;
+            for( Uint32 j = 1; j <= k; ++j )
+                thief.rootPath.push_back( victim.frames[j].push );
+            thief.rootPath.push_back( push );
+            thief.stolenBoxes.assign( &victim.boxes[k * boxCount], &victim.boxes[k * boxCount] + boxCount );
+            boxHash = frame.boxHash;
+            g = frame.g + push.pushCount;
+        }
+        this->visit( thief, &push, thief.stolenBoxes.data(), boxHash, g );
+        return true;
+    }
+    return false;
+}
+
+// --------------------------------------------------------------
+void ParallelSearch::visit( Worker& worker, const Push* push, const Uint16* parentBoxes, Uint64 parentHash, Uint32 g )
+{
+    Uint32 boxCount = m_Space.getBoxCount();
+    Uint32 depth = worker.depth.load( std::memory_order_relaxed );
+    Frame& frame = worker.frames[depth];
+    Uint16* boxes = &worker.boxes[depth * boxCount];
+    frame.g = g;
+    frame.boxHash = parentHash;
+    Uint32 row = 0;
+    if( push )
+    {
+        frame.push = *push;
+        frame.boxHash ^= m_Space.hashPush( *push );
+        row = m_Space.applyPush( parentBoxes, *push, boxes );
+    }else
+        std::copy( parentBoxes, parentBoxes + boxCount, boxes );
+
+    // cut off at the threshold, remembering the lowest f value cut off. The
+    // first frame has no assignment to start from
+    Uint32 bound = depth ?
+        worker.lowerBound.update( worker.frames[depth-1].state, boxes, push->box, row, frame.state ) :
+        worker.lowerBound.compute( boxes, frame.state );
+    if( bound == SearchSpace::NO_BOUND )
+        return;
+    Uint32 f = g + bound;
+    if( f > m_Threshold )
+    {
+        worker.nextThreshold = std::min( worker.nextThreshold, f );
+        return;
+    }
+
+    // consistent bounds mean no cheaper solution exists than the first one
+    // found within the threshold, no matter which thread finds it
+    if( bound == 0 && m_Space.isSolved( boxes ) )
+    {
+        std::lock_guard<std::mutex> lock( m_SolutionMutex );
+        if( !m_IsSolved )
+        {
+            m_IsSolved = true;
+            m_Solution = worker.rootPath;
+            for( Uint32 i = 1; i <= depth; ++i )
+                m_Solution.push_back( worker.frames[i].push );
+        }
+        m_IsStopped = true;
+        return;
+    }
+
+    // duplicates are found by the player's area, before paying for their pushes
+    Uint16 normalisedPlayer = m_Space.markReachable( boxes, push ? push->player : m_Space.getStartPlayer(), worker.scratch );
+    if( !m_Table.visit( m_Space.hashPosition( frame.boxHash, normalisedPlayer ), m_Iteration, g ) )
+    {
+        ++worker.duplicates;
+        return;
+    }
+    ++worker.nodesExpanded;
+    if( !this->checkLimits( worker ) )
+        return;
+
+    m_Space.generateMarkedPushes( boxes, worker.scratch, worker.pushes );
+    if( worker.pushes.empty() )
+        return;
+    Uint32 first = depth * this->getMaxPushCount();
+    std::copy( worker.pushes.begin(), worker.pushes.end(), worker.children.begin() + first );
+    worker.nodesGenerated += worker.pushes.size();
+
+    // thieves only look at the frame once depth is raised over it
+    frame.next.store( first, std::memory_order_relaxed );
+    frame.end.store( first + static_cast<Uint32>( worker.pushes.size() ), std::memory_order_relaxed );
+    worker.depth.store( depth+1, std::memory_order_release );
+}
+
+// --------------------------------------------------------------
+Uint32 ParallelSearch::getMaxPushCount( void ) const
+{
+    return 4 * m_Space.getBoxCount();
+}
+
+// --------------------------------------------------------------
+bool ParallelSearch::checkLimits( Worker& worker )
+{
+    if( worker.nodesExpanded % LIMIT_CHECK_INTERVAL != 0 )
+        return true;
+
+    Uint64 total = m_NodesExpanded.fetch_add( LIMIT_CHECK_INTERVAL ) + LIMIT_CHECK_INTERVAL;
+    if( (m_NodeLimit && total >= m_NodeLimit) ||
+        (m_HasDeadline && std::chrono::steady_clock::now() >= m_Deadline) ||
+        (m_CancelFlag && m_CancelFlag->load( std::memory_order_relaxed )) )
+    {
+        m_IsLimitReached = true;
+        m_IsStopped = true;
+        return false;
+    }
+    return true;
+}
+
+} // namespace Chocobun
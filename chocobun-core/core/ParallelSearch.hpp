@@ -0,0 +1,257 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Parallel search
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_PARALLEL_SEARCH_HPP__
+#define __CHOCOBUN_CORE_PARALLEL_SEARCH_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/LowerBound.hpp>
+#include <core/SearchSpace.hpp>
+#include <core/Solver.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Chocobun {
+
+/*!
+ * @brief A lock-free transposition table shared by several threads
+ *
+ * Every entry is a single 64 bit word holding the upper 32 bits of the
+ * position hash, a 16 bit iteration stamp and the number of pushes the
+ * position was reached with, so it can be updated with one compare-and-swap.
+ * The entries are split into shards selected by the lowest bits of the hash.
+ */
+class SharedTable
+{
+public:
+
+    /*!
+     * @brief Allocates the table
+     *
+     * @param megabytes The total size of all shards
+     */
+    SharedTable( Uint32 megabytes );
+
+    /*!
+     * @brief Destructor
+     */
+    ~SharedTable( void );
+
+    /*!
+     * @brief Forgets all entries, so a new iteration can be started
+     */
+    void clear( void );
+
+    /*!
+     * @brief Records that a position was reached in an iteration
+     *
+     * @param hash The position hash
+     * @param iteration The current iteration
+     * @param g The number of pushes the position was reached with
+     * @return False if the position was already reached with as few pushes
+     * in the same iteration
+     */
+    bool visit( Uint64 hash, Uint32 iteration, Uint32 g );
+
+private:
+
+    std::vector< std::unique_ptr< std::atomic<Uint64>[] > > m_Shards;
+    Uint64 m_ShardMask;
+    Uint64 m_EntryMask;
+    Uint32 m_ShardBits;
+};
+
+/*!
+ * @brief Iterative deepening A* searched by several threads at once
+ *
+ * Every thread searches depth first on a stack of its own, holding the
+ * positions on its current path together with the pushes of each of them
+ * not searched yet. A thread running out of work steals a push from the
+ * lowest position on the stack of another thread that still has one left,
+ * which hands over the largest remaining subtree, and copies the path to
+ * it. Apart from these steals, threads only share the SharedTable pruning
+ * duplicates, so searching a position doesn't allocate memory or touch
+ * data of other threads. An iteration is over once every thread is idle.
+ *
+ * Used by Solver with Solver::MODE_PARALLEL.
+ */
+class ParallelSearch
+{
+public:
+
+    /*!
+     * @brief Constructor
+     *
+     * @param space The search space, shared by all threads
+     * @param heuristic The lower bound to search with
+     * @param threadCount The number of threads to search with
+     * @param tableMegabytes The size of the transposition table
+     */
+    ParallelSearch( const SearchSpace& space, Solver::Heuristic heuristic, Uint32 threadCount, Uint32 tableMegabytes );
+
+    /*!
+     * @brief Destructor
+     */
+    ~ParallelSearch( void );
+
+    /*!
+     * @brief Searches for a solution with the fewest pushes
+     *
+     * @param nodeLimit The maximum number of positions to expand, or 0 for
+     * no limit. It is checked in steps, so slightly more may be expanded
+     * @param timeLimit The maximum search time in seconds, or 0 for no limit
+     * @param cancelFlag Stops the search once set, may be 0 (see Solver::setCancelFlag)
+     * @param solution Receives the pushes of the solution
+     * @param statistics Receives the numbers collected by all threads
+     */
+    Solver::Result run( Uint64 nodeLimit, double timeLimit, const std::atomic<bool>* cancelFlag, std::vector<Push>& solution, Solver::Statistics& statistics );
+
+private:
+
+    // a position on the path of a thread. Its pushes not searched yet are
+    // Worker::children[next] to Worker::children[end-1]. The thread takes
+    // them from next, thieves take them from end
+    struct Frame
+    {
+        LowerBound::State state;
+        Push push;          // the push leading here from the frame below
+        Uint64 boxHash;
+        Uint32 g;
+        std::atomic<Uint32> next;
+        std::atomic<Uint32> end;
+    };
+
+    // everything owned by one thread. All storage is sized for the deepest
+    // path possible when an iteration starts, so nothing moves while other
+    // threads steal. Thieves hold the mutex, which the thread itself only
+    // takes to drop a frame or when racing a thief for the last push of a
+    // frame, so frames below depth are never reused while being stolen from
+    struct Worker
+    {
+        Worker( const SearchSpace& space, Solver::Heuristic heuristic ) :
+            frameCount( 0 ),
+            depth( 0 ),
+            lowerBound( space, heuristic ),
+            nodesExpanded( 0 ),
+            nodesGenerated( 0 ),
+            duplicates( 0 ),
+            nextThreshold( 0 )
+        {}
+
+        std::mutex mutex;
+        std::unique_ptr<Frame[]> frames;
+        Uint32 frameCount;
+        std::vector<Uint16> boxes;          // the boxes of frame i start at i * box count
+        std::vector<Push> children;         // the pushes of frame i start at i * getMaxPushCount()
+        std::vector<Push> rootPath;         // the pushes leading to frames[0]
+        std::atomic<Uint32> depth;          // the number of frames in use
+        SearchScratch scratch;
+        LowerBound lowerBound;
+        std::vector<Push> pushes;
+        std::vector<Uint16> stolenBoxes;
+        Uint64 nodesExpanded;
+        Uint64 nodesGenerated;
+        Uint64 duplicates;
+        Uint32 nextThreshold;
+    };
+
+    /*!
+     * @brief The main loop of a thread during one iteration
+     */
+    void work( Uint32 id );
+
+    /*!
+     * @brief Waits until work can be stolen from another thread, or every thread is idle
+     *
+     * @return False once the iteration is over
+     */
+    bool waitForWork( Uint32 id );
+
+    /*!
+     * @brief Takes the push of the lowest position of another thread that still has one
+     *
+     * The position it leads to becomes the first frame of the thread.
+     */
+    bool stealWork( Uint32 id );
+
+    /*!
+     * @brief Takes the next push of the top frame of the thread's own stack
+     *
+     * @return False if the frame has none left, in which case it is dropped
+     */
+    bool takePush( Worker& worker, Uint32 depth, Push& push );
+
+    /*!
+     * @brief Searches a position and pushes it as a new frame if any of its successors need searching
+     *
+     * @param worker The thread searching
+     * @param push The push leading to the position from the top frame (or
+     * from a stolen position if the thread has no frames), or 0 for the
+     * start position
+     * @param parentBoxes The boxes before the push
+     * @param parentHash The box hash before the push
+     * @param g The number of pushes the position was reached with
+     */
+    void visit( Worker& worker, const Push* push, const Uint16* parentBoxes, Uint64 parentHash, Uint32 g );
+
+    /*!
+     * @brief Returns the most pushes a single position can have
+     */
+    Uint32 getMaxPushCount( void ) const;
+
+    /*!
+     * @brief Checks the limits after an expansion and stops the search if a limit is reached
+     */
+    bool checkLimits( Worker& worker );
+
+    const SearchSpace& m_Space;
+    SharedTable m_Table;
+    std::vector< std::unique_ptr<Worker> > m_Workers;
+
+    // state of the current iteration
+    std::atomic<Uint32> m_IdleCount;
+    std::atomic<Uint64> m_NodesExpanded;
+    std::atomic<bool> m_IsStopped;
+    Uint32 m_Threshold;
+    Uint32 m_Iteration;
+
+    // outcome
+    std::mutex m_SolutionMutex;
+    std::vector<Push> m_Solution;
+    bool m_IsSolved;
+    std::atomic<bool> m_IsLimitReached;
+
+    Uint64 m_NodeLimit;
+    std::chrono::steady_clock::time_point m_Deadline;
+    bool m_HasDeadline;
+    const std::atomic<bool>* m_CancelFlag;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_PARALLEL_SEARCH_HPP__
@@ -0,0 +1,152 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Pattern database
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/PatternDatabase.hpp>
+#include <core/Exception.hpp>
+
+#include <cstring>
+
+#if defined(CHOCOBUN_CORE_PLATFORM_WINDOWS)
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace Chocobun {
+
+const Uint32 PatternDatabase::VERSION;
+const Uint32 PatternDatabase::MAX_TILES;
+
+// --------------------------------------------------------------
+PatternDatabase::PatternDatabase( void ) :
+    m_Patterns( 0 ),
+    m_Mapping( 0 ),
+    m_MappingSize( 0 ),
+    m_Width( 0 ),
+    m_Height( 0 )
+{
+}
+
+// --------------------------------------------------------------
+PatternDatabase::~PatternDatabase( void )
+{
+    this->unload();
+}
+
+// --------------------------------------------------------------
+Uint64 PatternDatabase::getPatternBytes( Uint32 width, Uint32 height )
+{
+    Uint64 patternCount = 1;
+    for( Uint32 i = 0; i != width*height; ++i )
+        patternCount *= 3;
+    return (patternCount + 7) / 8;
+}
+
+// --------------------------------------------------------------
+void PatternDatabase::load( const std::string& fileName )
+{
+    this->unload();
+
+    // map the whole file read-only
+#if defined(CHOCOBUN_CORE_PLATFORM_WINDOWS)
+    HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+    if( file == INVALID_HANDLE_VALUE )
+        throw Exception( "[PatternDatabase::load] failed to open pattern database file" );
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx( file, &fileSize );
+    HANDLE mapping = CreateFileMappingA( file, 0, PAGE_READONLY, 0, 0, 0 );
+    CloseHandle( file );
+    if( !mapping )
+        throw Exception( "[PatternDatabase::load] failed to map pattern database file" );
+    m_Mapping = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( mapping );
+    if( !m_Mapping )
+        throw Exception( "[PatternDatabase::load] failed to map pattern database file" );
+    m_MappingSize = static_cast<Uint64>( fileSize.QuadPart );
+#else
+    int file = open( fileName.c_str(), O_RDONLY );
+    if( file < 0 )
+        throw Exception( "[PatternDatabase::load] failed to open pattern database file" );
+    struct stat status;
+    if( fstat( file, &status ) != 0 || status.st_size == 0 )
+    {
+        close( file );
+        throw Exception( "[PatternDatabase::load] failed to read pattern database file" );
+    }
+    void* mapping = mmap( 0, static_cast<size_t>( status.st_size ), PROT_READ, MAP_SHARED, file, 0 );
+    close( file );
+    if( mapping == MAP_FAILED )
+        throw Exception( "[PatternDatabase::load] failed to map pattern database file" );
+    m_Mapping = mapping;
+    m_MappingSize = static_cast<Uint64>( status.st_size );
+#endif
+
+    // check the header before trusting any size in it
+    Header header;
+    bool isValid = ( m_MappingSize >= sizeof(Header) );
+    if( isValid )
+    {
+        std::memcpy( &header, m_Mapping, sizeof(Header) );
+        isValid = std::memcmp( header.magic, "CHOCOPDB", 8 ) == 0 &&
+                  header.version == VERSION &&
+                  header.width != 0 && header.height != 0 &&
+                  header.width * header.height <= MAX_TILES &&
+                  m_MappingSize >= sizeof(Header) + getPatternBytes( header.width, header.height );
+    }
+    if( !isValid )
+    {
+        this->unload();
+        throw Exception( "[PatternDatabase::load] file is not a valid pattern database" );
+    }
+
+    m_Width = header.width;
+    m_Height = header.height;
+    m_Digits[0] = 1;
+    for( Uint32 i = 1; i != m_Width*m_Height; ++i )
+        m_Digits[i] = m_Digits[i-1] * 3;
+    m_Patterns = static_cast<const Uint8*>( m_Mapping ) + sizeof(Header);
+}
+
+// --------------------------------------------------------------
+void PatternDatabase::unload( void )
+{
+    if( m_Mapping )
+    {
+#if defined(CHOCOBUN_CORE_PLATFORM_WINDOWS)
+        UnmapViewOfFile( m_Mapping );
+#else
+        munmap( m_Mapping, static_cast<size_t>( m_MappingSize ) );
+#endif
+    }
+    m_Patterns = 0;
+    m_Mapping = 0;
+    m_MappingSize = 0;
+    m_Width = 0;
+    m_Height = 0;
+}
+
+} // namespace Chocobun
@@ -0,0 +1,222 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Pattern database
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_PATTERN_DATABASE_HPP__
+#define __CHOCOBUN_CORE_PATTERN_DATABASE_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Export.hpp>
+#include <core/CompiledLevel.hpp>
+
+#include <string>
+
+namespace Chocobun {
+
+/*!
+ * @brief A precomputed table of deadlocked box/wall patterns
+ *
+ * A pattern is a small rectangular window of the level in which every tile
+ * is either floor, wall or a box. Goals are not part of patterns: a pattern
+ * is deadlocked if, with no goal inside the window, the boxes can never all
+ * be pushed out of it. Everything outside of the window is assumed to be
+ * empty floor the player can walk on, so a pattern found deadlocked is
+ * deadlocked in every level it appears in (unless the window holds a goal).
+ *
+ * The table is generated offline by the chocobun-patterns tool and mapped
+ * into memory read-only, so it can be queried by any number of threads at
+ * once without locking or allocating.
+ *
+ * The file starts with a Header, followed by one bit per pattern. The bit
+ * of a pattern is found by reading its tiles in row-major order as the
+ * base 3 digits of a number (see TileCode), the first tile being the least
+ * significant digit. A set bit means the pattern is deadlocked.
+ */
+class CHOCOBUN_CORE_API PatternDatabase
+{
+public:
+
+    /*!
+     * @brief The digits tiles are encoded with
+     */
+    enum TileCode
+    {
+        TILE_FLOOR = 0,
+        TILE_WALL = 1,
+        TILE_BOX = 2
+    };
+
+    /*!
+     * @brief The header at the start of a pattern database file
+     */
+    struct Header
+    {
+        char magic[8];      //!< "CHOCOPDB"
+        Uint32 version;     //!< VERSION
+        Uint32 width;       //!< The width of the window
+        Uint32 height;      //!< The height of the window
+        Uint32 reserved;    //!< Always 0
+    };
+
+    /*!
+     * @brief The file format version written and understood
+     */
+    static const Uint32 VERSION = 1;
+
+    /*!
+     * @brief The largest number of tiles in a window
+     */
+    static const Uint32 MAX_TILES = 20;
+
+    /*!
+     * @brief Constructor
+     *
+     * The database is empty until a file is loaded.
+     */
+    PatternDatabase( void );
+
+    /*!
+     * @brief Destructor
+     *
+     * Unmaps the file.
+     */
+    ~PatternDatabase( void );
+
+    /*!
+     * @brief Maps a pattern database file into memory
+     *
+     * Any previously loaded file is unloaded first.
+     *
+     * @exception Chocobun::Exception If the file can't be opened or isn't a
+     * valid pattern database
+     *
+     * @param fileName The file to load
+     */
+    void load( const std::string& fileName );
+
+    /*!
+     * @brief Unmaps the file, if one is loaded
+     */
+    void unload( void );
+
+    /*!
+     * @brief Returns true if a file is loaded
+     */
+    bool isLoaded( void ) const { return m_Patterns != 0; }
+
+    /*!
+     * @brief Returns the width of the window, or 0 if no file is loaded
+     */
+    Uint32 getWidth( void ) const { return m_Width; }
+
+    /*!
+     * @brief Returns the height of the window, or 0 if no file is loaded
+     */
+    Uint32 getHeight( void ) const { return m_Height; }
+
+    /*!
+     * @brief Returns true if a pattern is deadlocked
+     *
+     * @param index The pattern, encoded as described in the class documentation
+     */
+    bool isDeadlockPattern( Uint64 index ) const { return (m_Patterns[index >> 3] >> (index & 7)) & 1; }
+
+    /*!
+     * @brief Returns the number of bytes needed to store every pattern of a window
+     */
+    static Uint64 getPatternBytes( Uint32 width, Uint32 height );
+
+    /*!
+     * @brief Returns true if a box is part of a deadlocked pattern
+     *
+     * Every placement of the window covering the box is looked up, so the
+     * number of probes is bounded by the window size. Placements covering a
+     * goal are skipped. Tiles that aren't cells of the compiled level count
+     * as walls.
+     *
+     * @param level The compiled level
+     * @param cell The cell of the box, usually the one just pushed
+     * @param hasBox Function object taking a cell and returning true if
+     * there is a box on it
+     * @return True if a deadlocked pattern was found, false if not or if no
+     * file is loaded
+     */
+    template <class BoxTest>
+    bool isDeadlock( const CompiledLevel& level, Uint32 cell, const BoxTest& hasBox ) const;
+
+private:
+
+    // non-copyable, the mapping is owned
+    PatternDatabase( const PatternDatabase& );
+    PatternDatabase& operator=( const PatternDatabase& );
+
+    const Uint8* m_Patterns;
+    void* m_Mapping;
+    Uint64 m_MappingSize;
+    Uint32 m_Width;
+    Uint32 m_Height;
+
+    // powers of 3 for the tiles of a window
+    Uint64 m_Digits[MAX_TILES];
+};
+
+// --------------------------------------------------------------
+template <class BoxTest>
+bool PatternDatabase::isDeadlock( const CompiledLevel& level, Uint32 cell, const BoxTest& hasBox ) const
+{
+    if( !m_Patterns ) return false;
+
+    Int32 cellX = static_cast<Int32>( level.getX( cell ) );
+    Int32 cellY = static_cast<Int32>( level.getY( cell ) );
+    for( Uint32 offsetY = 0; offsetY != m_Height; ++offsetY )
+    for( Uint32 offsetX = 0; offsetX != m_Width; ++offsetX )
+    {
+        // encode the window with the box at (offsetX, offsetY)
+        Uint64 index = 0;
+        bool hasGoal = false;
+        for( Uint32 y = 0; y != m_Height && !hasGoal; ++y )
+        for( Uint32 x = 0; x != m_Width; ++x )
+        {
+            Int32 tileX = cellX - static_cast<Int32>(offsetX) + static_cast<Int32>(x);
+            Int32 tileY = cellY - static_cast<Int32>(offsetY) + static_cast<Int32>(y);
+            Uint32 tile = CompiledLevel::NO_CELL;
+            if( tileX >= 0 && tileY >= 0 )
+                tile = level.getCell( static_cast<Uint32>(tileX), static_cast<Uint32>(tileY) );
+            if( tile == CompiledLevel::NO_CELL )
+                index += m_Digits[y*m_Width + x] * TILE_WALL;
+            else if( level.isGoal( tile ) )
+            {
+                hasGoal = true;
+                break;
+            }
+            else if( hasBox( tile ) )
+                index += m_Digits[y*m_Width + x] * TILE_BOX;
+        }
+        if( !hasGoal && this->isDeadlockPattern( index ) )
+            return true;
+    }
+    return false;
+}
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_PATTERN_DATABASE_HPP__
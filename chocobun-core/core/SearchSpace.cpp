@@ -0,0 +1,556 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Search space
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/SearchSpace.hpp>
+#include <core/CompiledLevel.hpp>
+#include <core/PatternDatabase.hpp>
+#include <core/LevelState.hpp>
+#include <core/Zobrist.hpp>
+#include <core/Exception.hpp>
+
+#include <algorithm>
+
+namespace Chocobun {
+
+const Uint32 SearchSpace::NO_BOUND;
+
+// --------------------------------------------------------------
+SearchSpace::SearchSpace( const Level& level, bool isUsingMacroMoves ) :
+    m_Level( level.createBranch() ),
+    m_CompiledLevel( m_Level.getCompiledLevel() ),
+    m_PatternDatabase( level.getPatternDatabase() ),
+    m_StartPlayer( 0 ),
+    m_IsFeasible( true ),
+    m_IsUsingMacroMoves( isUsingMacroMoves )
+{
+    Uint32 cellCount = m_CompiledLevel.getCellCount();
+    if( cellCount == 0 )
+        throw Exception( "[SearchSpace::SearchSpace] level hasn't been validated" );
+    if( cellCount > 0xFFFF )
+        throw Exception( "[SearchSpace::SearchSpace] level is too large" );
+
+    // collect the boxes the player can get to. Boxes outside of the cell
+    // graph can never move, which is only fine if they are on a goal
+    LevelState state;
+    m_Level.saveState( state );
+    Uint32 end = state.boxes.getWordCount() * 64;
+    for( Uint32 index = state.boxes.findNext( 0 ); index != end; index = state.boxes.findNext( index+1 ) )
+    {
+        Uint32 cell = m_CompiledLevel.getCell( index );
+        Uint32 stride = m_Level.getSizeX() + 2;
+        if( cell != CompiledLevel::NO_CELL )
+            m_StartBoxes.push_back( static_cast<Uint16>(cell) );
+        else if( m_Level.getTile( index % stride, index / stride ) != '*' ) // getTile is 1-based
+            m_IsFeasible = false;
+    }
+    std::sort( m_StartBoxes.begin(), m_StartBoxes.end() );
+    if( m_StartBoxes.size() > m_CompiledLevel.getGoalCells().size() )
+        m_IsFeasible = false;
+    m_StartPlayer = static_cast<Uint16>( m_CompiledLevel.getCell( state.playerIndex ) );
+
+    // keys are looked up a lot, so they are cached per cell
+    m_BoxKeys.resize( cellCount );
+    m_PlayerKeys.resize( cellCount );
+    for( Uint32 cell = 0; cell != cellCount; ++cell )
+    {
+        m_BoxKeys[cell] = Zobrist::getBoxKey( cell );
+        m_PlayerKeys[cell] = Zobrist::getPlayerKey( cell );
+    }
+
+    // pull distances to every start box cell. A pull is a push turned
+    // around, so these are the push distances from the start boxes
+    m_PullDistances.assign( m_StartBoxes.size() * cellCount, CompiledLevel::NO_DISTANCE );
+    m_MinPullDistances.assign( cellCount, CompiledLevel::NO_DISTANCE );
+    std::vector<Uint16> queue;
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+    {
+        Uint16* distances = &m_PullDistances[i * cellCount];
+        queue.assign( 1, m_StartBoxes[i] );
+        distances[m_StartBoxes[i]] = 0;
+        for( Uint32 head = 0; head != queue.size(); ++head )
+        {
+            Uint32 cell = queue[head];
+            m_MinPullDistances[cell] = std::min( m_MinPullDistances[cell], distances[cell] );
+            for( Uint32 direction = 0; direction != 4; ++direction )
+            {
+                Uint32 side = m_CompiledLevel.getNeighbour( cell, direction ^ 1 );
+                Uint32 to = m_CompiledLevel.getNeighbour( cell, direction );
+                if( side == CompiledLevel::NO_CELL || to == CompiledLevel::NO_CELL ) continue;
+                if( distances[to] != CompiledLevel::NO_DISTANCE ) continue;
+                distances[to] = static_cast<Uint16>( distances[cell] + 1 );
+                queue.push_back( static_cast<Uint16>( to ) );
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------------
+SearchSpace::~SearchSpace( void )
+{
+}
+
+// --------------------------------------------------------------
+Uint16 SearchSpace::markReachable( const Uint16* boxes, Uint16 player, SearchScratch& scratch ) const
+{
+    Uint32 cellCount = m_CompiledLevel.getCellCount();
+    if( scratch.reachMarks.size() != cellCount )
+    {
+        scratch.reachMarks.assign( cellCount, 0 );
+        scratch.boxMarks.assign( cellCount, 0 );
+        scratch.stack.resize( cellCount );
+        scratch.reachMark = 0;
+        scratch.boxMark = 0;
+        scratch.corralMarks.assign( cellCount, 0 );
+        scratch.corralBoxMarks.assign( cellCount, 0 );
+        scratch.corralMark = 0;
+    }
+
+    // marks are compared against a running counter, so they never need clearing
+    if( ++scratch.boxMark == 0 )
+    {
+        std::fill( scratch.boxMarks.begin(), scratch.boxMarks.end(), 0 );
+        scratch.boxMark = 1;
+    }
+    if( ++scratch.reachMark == 0 )
+    {
+        std::fill( scratch.reachMarks.begin(), scratch.reachMarks.end(), 0 );
+        scratch.reachMark = 1;
+    }
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+        scratch.boxMarks[boxes[i]] = scratch.boxMark;
+
+    // flood fill from the player
+    Uint16 lowest = player;
+    Uint32 top = 0;
+    scratch.stack[top++] = player;
+    scratch.reachMarks[player] = scratch.reachMark;
+    while( top )
+    {
+        Uint16 cell = scratch.stack[--top];
+        if( cell < lowest ) lowest = cell;
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 next = m_CompiledLevel.getNeighbour( cell, direction );
+            if( next == CompiledLevel::NO_CELL ) continue;
+            if( scratch.reachMarks[next] == scratch.reachMark || scratch.boxMarks[next] == scratch.boxMark ) continue;
+            scratch.reachMarks[next] = scratch.reachMark;
+            scratch.stack[top++] = static_cast<Uint16>( next );
+        }
+    }
+    return lowest;
+}
+
+// --------------------------------------------------------------
+Uint16 SearchSpace::generatePushes( const Uint16* boxes, Uint16 player, SearchScratch& scratch, std::vector<Push>& pushes ) const
+{
+    Uint16 normalisedPlayer = this->markReachable( boxes, player, scratch );
+    this->generateMarkedPushes( boxes, scratch, pushes );
+    return normalisedPlayer;
+}
+
+// --------------------------------------------------------------
+void SearchSpace::generateMarkedPushes( const Uint16* boxes, SearchScratch& scratch, std::vector<Push>& pushes ) const
+{
+    pushes.clear();
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+    {
+        Uint32 box = boxes[i];
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 side = m_CompiledLevel.getNeighbour( box, direction ^ 1 );
+            Uint32 to = m_CompiledLevel.getNeighbour( box, direction );
+            if( side == CompiledLevel::NO_CELL || to == CompiledLevel::NO_CELL ) continue;
+            if( scratch.reachMarks[side] != scratch.reachMark ) continue;
+            if( scratch.boxMarks[to] == scratch.boxMark ) continue;
+            if( m_CompiledLevel.isDead( to ) ) continue;
+
+            Push push;
+            push.box = static_cast<Uint16>( i );
+            push.from = static_cast<Uint16>( box );
+            push.to = static_cast<Uint16>( to );
+            push.player = static_cast<Uint16>( box );
+            push.pushCount = 1;
+            push.direction = static_cast<Uint8>( direction );
+            push.macro = Push::MACRO_NONE;
+            if( m_IsUsingMacroMoves )
+                this->applyMacro( boxes, scratch, push );
+
+            // the other boxes are still marked, only the pushed one moves
+            const Uint32* boxMarks = scratch.boxMarks.data();
+            Uint32 boxMark = scratch.boxMark;
+            Uint32 end = push.to;
+            auto hasBox = [boxMarks, boxMark, box, end]( Uint32 cell ) {
+                return cell == end || (cell != box && boxMarks[cell] == boxMark);
+            };
+            if( m_CompiledLevel.isFreezeDeadlock( end, hasBox ) ) continue;
+            if( m_PatternDatabase && m_PatternDatabase->isDeadlock( m_CompiledLevel, end, hasBox ) ) continue;
+            pushes.push_back( push );
+        }
+    }
+
+    this->restrictToCorral( boxes, scratch, pushes );
+}
+
+// --------------------------------------------------------------
+Uint16 SearchSpace::generatePulls( const Uint16* boxes, Uint16 player, SearchScratch& scratch, std::vector<Push>& pulls ) const
+{
+    pulls.clear();
+    Uint16 normalisedPlayer = this->markReachable( boxes, player, scratch );
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+    {
+        Uint32 box = boxes[i];
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            // the player stands on to and steps back onto side
+            Uint32 to = m_CompiledLevel.getNeighbour( box, direction );
+            if( to == CompiledLevel::NO_CELL ) continue;
+            Uint32 side = m_CompiledLevel.getNeighbour( to, direction );
+            if( side == CompiledLevel::NO_CELL ) continue;
+            if( scratch.reachMarks[to] != scratch.reachMark ) continue;
+            if( scratch.boxMarks[side] == scratch.boxMark ) continue;
+            if( m_MinPullDistances[to] == CompiledLevel::NO_DISTANCE ) continue;
+
+            Push pull;
+            pull.box = static_cast<Uint16>( i );
+            pull.from = static_cast<Uint16>( box );
+            pull.to = static_cast<Uint16>( to );
+            pull.player = static_cast<Uint16>( side );
+            pull.pushCount = 1;
+            pull.direction = static_cast<Uint8>( direction );
+            pull.macro = Push::MACRO_NONE;
+            pulls.push_back( pull );
+        }
+    }
+    return normalisedPlayer;
+}
+
+// --------------------------------------------------------------
+void SearchSpace::findSolvedPositions( SearchScratch& scratch, std::vector<Uint16>& boxes, std::vector<Uint16>& players ) const
+{
+    boxes.clear();
+    players.clear();
+    const std::vector<Uint32>& goals = m_CompiledLevel.getGoalCells();
+    if( goals.size() != m_StartBoxes.size() ) return;
+    for( Uint32 i = 0; i != goals.size(); ++i )
+        boxes.push_back( static_cast<Uint16>( goals[i] ) );
+    std::sort( boxes.begin(), boxes.end() );
+
+    // flood fill every area the boxes leave free
+    Uint32 cellCount = m_CompiledLevel.getCellCount();
+    std::vector<bool> isCovered( cellCount, false );
+    for( Uint32 i = 0; i != boxes.size(); ++i )
+        isCovered[boxes[i]] = true;
+    for( Uint32 cell = 0; cell != cellCount; ++cell )
+    {
+        if( isCovered[cell] ) continue;
+        players.push_back( this->markReachable( boxes.data(), static_cast<Uint16>( cell ), scratch ) );
+        for( Uint32 other = cell; other != cellCount; ++other )
+            if( scratch.reachMarks[other] == scratch.reachMark )
+                isCovered[other] = true;
+    }
+}
+
+// --------------------------------------------------------------
+void SearchSpace::restrictToCorral( const Uint16* boxes, SearchScratch& scratch, std::vector<Push>& pushes ) const
+{
+    const Uint32 reachMark = scratch.reachMark;
+    const Uint32 boxMark = scratch.boxMark;
+
+    // every corral gets a mark of its own, so there must be room for one
+    // per box side (and one more) before the marks wrap around
+    if( scratch.corralMark >= 0xFFFFFFFF - m_StartBoxes.size() * 4 - 1 )
+    {
+        std::fill( scratch.corralMarks.begin(), scratch.corralMarks.end(), 0 );
+        std::fill( scratch.corralBoxMarks.begin(), scratch.corralBoxMarks.end(), 0 );
+        scratch.corralMark = 0;
+    }
+    const Uint32 firstMark = scratch.corralMark + 1;
+    Uint32 bestPushCount = static_cast<Uint32>( pushes.size() );
+    bool isRestricted = false;
+
+    // corrals are found by flood filling the unreachable cells next to boxes
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+    for( Uint32 direction = 0; direction != 4; ++direction )
+    {
+        Uint32 start = m_CompiledLevel.getNeighbour( boxes[i], direction );
+        if( start == CompiledLevel::NO_CELL ) continue;
+        if( scratch.reachMarks[start] == reachMark || scratch.boxMarks[start] == boxMark ) continue;
+        if( scratch.corralMarks[start] >= firstMark ) continue;
+
+        // collect the area and the boxes bordering it
+        const Uint32 mark = ++scratch.corralMark;
+        bool isSolved = true;
+        scratch.corralBoxes.clear();
+        Uint32 top = 0;
+        scratch.stack[top++] = static_cast<Uint16>( start );
+        scratch.corralMarks[start] = mark;
+        while( top )
+        {
+            Uint32 cell = scratch.stack[--top];
+            if( m_CompiledLevel.isGoal( cell ) ) isSolved = false;
+            for( Uint32 next = 0; next != 4; ++next )
+            {
+                Uint32 neighbour = m_CompiledLevel.getNeighbour( cell, next );
+                if( neighbour == CompiledLevel::NO_CELL ) continue;
+                if( scratch.boxMarks[neighbour] == boxMark )
+                {
+                    if( scratch.corralBoxMarks[neighbour] == mark ) continue;
+                    scratch.corralBoxMarks[neighbour] = mark;
+                    scratch.corralBoxes.push_back( static_cast<Uint16>( neighbour ) );
+                    if( !m_CompiledLevel.isGoal( neighbour ) ) isSolved = false;
+                }
+                else if( scratch.corralMarks[neighbour] != mark )
+                {
+                    scratch.corralMarks[neighbour] = mark;
+                    scratch.stack[top++] = static_cast<Uint16>( neighbour );
+                }
+            }
+        }
+
+        // a solved corral may never need to be touched again
+        if( isSolved ) continue;
+
+        // check that every push of a bordering box goes into the corral (I)
+        // and can be made from where the player is (P). Pushes out of the
+        // corral count even if they are blocked by a box right now, because
+        // other pushes could clear the way
+        bool isPICorral = true;
+        for( Uint32 j = 0; j != scratch.corralBoxes.size() && isPICorral; ++j )
+        for( Uint32 pushDirection = 0; pushDirection != 4; ++pushDirection )
+        {
+            Uint32 side = m_CompiledLevel.getNeighbour( scratch.corralBoxes[j], pushDirection ^ 1 );
+            Uint32 to = m_CompiledLevel.getNeighbour( scratch.corralBoxes[j], pushDirection );
+            if( side == CompiledLevel::NO_CELL || to == CompiledLevel::NO_CELL ) continue;
+            bool isSideInCorral = ( scratch.corralMarks[side] == mark );
+            bool isPushIntoCorral = ( scratch.corralMarks[to] == mark );
+            if( isPushIntoCorral ? (!isSideInCorral && scratch.reachMarks[side] != reachMark) : !isSideInCorral )
+            {
+                isPICorral = false;
+                break;
+            }
+        }
+        if( !isPICorral ) continue;
+
+        // prefer the corral leaving the fewest pushes
+        Uint32 pushCount = 0;
+        for( Uint32 j = 0; j != pushes.size(); ++j )
+            if( scratch.corralBoxMarks[pushes[j].from] == mark )
+                ++pushCount;
+        if( !isRestricted || pushCount < bestPushCount )
+        {
+            isRestricted = true;
+            bestPushCount = pushCount;
+            scratch.bestCorralBoxes.swap( scratch.corralBoxes );
+        }
+    }
+    if( !isRestricted ) return;
+
+    // marks of the best corral may have been overwritten by later corrals
+    const Uint32 bestMark = ++scratch.corralMark;
+    for( Uint32 j = 0; j != scratch.bestCorralBoxes.size(); ++j )
+        scratch.corralBoxMarks[scratch.bestCorralBoxes[j]] = bestMark;
+    std::vector<Push>::iterator end = pushes.begin();
+    for( std::vector<Push>::iterator it = pushes.begin(); it != pushes.end(); ++it )
+        if( scratch.corralBoxMarks[it->from] == bestMark )
+            *end++ = *it;
+    pushes.erase( end, pushes.end() );
+}
+
+// --------------------------------------------------------------
+void SearchSpace::applyMacro( const Uint16* boxes, const SearchScratch& scratch, Push& push ) const
+{
+    // follow a tunnel as long as the player is stuck behind the box. Goal
+    // rooms are left to their own macro
+    Uint32 player = push.from;
+    Uint32 box = push.to;
+    while( !m_CompiledLevel.isGoal( box ) &&
+           m_CompiledLevel.isTunnel( player, push.direction ) &&
+           m_CompiledLevel.isTunnel( box, push.direction ) )
+    {
+        Uint32 next = m_CompiledLevel.getNeighbour( box, push.direction );
+        if( next == CompiledLevel::NO_CELL || scratch.boxMarks[next] == scratch.boxMark ) break;
+        if( m_CompiledLevel.isDead( next ) || m_CompiledLevel.getGoalRoom( next ) != CompiledLevel::NO_ROOM ) break;
+        player = box;
+        box = next;
+        ++push.pushCount;
+        push.macro = Push::MACRO_TUNNEL;
+    }
+    push.to = static_cast<Uint16>( box );
+    push.player = static_cast<Uint16>( player );
+
+    const std::vector<CompiledLevel::GoalRoom>& rooms = m_CompiledLevel.getGoalRooms();
+    for( Uint32 room = 0; room != rooms.size(); ++room )
+    {
+        if( rooms[room].entrance != box || m_CompiledLevel.getGoalRoom( player ) == room ) continue;
+
+        // the boxes in the room have to be on the first goals of the order
+        Uint32 filled = 0;
+        for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+            if( m_CompiledLevel.getGoalRoom( boxes[i] ) == room )
+                ++filled;
+        const std::vector<Uint32>& goals = rooms[room].goals;
+        if( filled >= goals.size() ) continue;
+        bool isInOrder = true;
+        for( Uint32 i = 0; i != m_StartBoxes.size() && isInOrder; ++i )
+            if( m_CompiledLevel.getGoalRoom( boxes[i] ) == room )
+                isInOrder = std::find( goals.begin(), goals.begin() + filled, boxes[i] ) != goals.begin() + filled;
+        if( !isInOrder ) continue;
+
+        const std::vector<Uint8>& route = rooms[room].routes[filled*4 + push.direction];
+        if( route.empty() ) continue;
+        push.to = static_cast<Uint16>( goals[filled] );
+        push.player = static_cast<Uint16>( m_CompiledLevel.getNeighbour( push.to, route.back() ^ 1 ) );
+        push.pushCount = static_cast<Uint16>( push.pushCount + route.size() );
+        push.macro = Push::MACRO_GOAL_ROOM;
+        break;
+    }
+}
+
+// --------------------------------------------------------------
+void SearchSpace::appendSinglePushes( const Push& push, std::vector<Push>& pushes ) const
+{
+    // a goal room route follows the straight part
+    const std::vector<Uint8>* route = 0;
+    Uint32 straightCount = push.pushCount;
+    if( push.macro == Push::MACRO_GOAL_ROOM )
+    {
+        const CompiledLevel::GoalRoom& room = m_CompiledLevel.getGoalRooms()[m_CompiledLevel.getGoalRoom( push.to )];
+        Uint32 stage = static_cast<Uint32>( std::find( room.goals.begin(), room.goals.end(), push.to ) - room.goals.begin() );
+        route = &room.routes[stage*4 + push.direction];
+        straightCount -= static_cast<Uint32>( route->size() );
+    }
+
+    Push single = push;
+    single.pushCount = 1;
+    single.macro = Push::MACRO_NONE;
+    for( Uint32 i = 0; i != straightCount + (route ? route->size() : 0); ++i )
+    {
+        single.direction = ( i < straightCount ? push.direction : (*route)[i - straightCount] );
+        single.to = static_cast<Uint16>( m_CompiledLevel.getNeighbour( single.from, single.direction ) );
+        single.player = single.from;
+        pushes.push_back( single );
+        single.from = single.to;
+    }
+}
+
+// --------------------------------------------------------------
+Uint32 SearchSpace::applyPush( const Uint16* boxes, const Push& push, Uint16* result ) const
+{
+    // copy everything, then move the box to its sorted position
+    Uint32 count = static_cast<Uint32>( m_StartBoxes.size() );
+    std::copy( boxes, boxes + count, result );
+    Uint32 i = push.box;
+    while( i > 0 && result[i-1] > push.to )
+    {
+        result[i] = result[i-1];
+        --i;
+    }
+    while( i+1 < count && result[i+1] < push.to )
+    {
+        result[i] = result[i+1];
+        ++i;
+    }
+    result[i] = push.to;
+    return i;
+}
+
+// --------------------------------------------------------------
+Uint64 SearchSpace::hashBoxes( const Uint16* boxes ) const
+{
+    Uint64 hash = 0;
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+        hash ^= m_BoxKeys[boxes[i]];
+    return hash;
+}
+
+// --------------------------------------------------------------
+Uint64 SearchSpace::hashPush( const Push& push ) const
+{
+    return m_BoxKeys[push.from] ^ m_BoxKeys[push.to];
+}
+
+// --------------------------------------------------------------
+Uint64 SearchSpace::hashPosition( Uint64 boxHash, Uint16 normalisedPlayer ) const
+{
+    return boxHash ^ m_PlayerKeys[normalisedPlayer];
+}
+
+// --------------------------------------------------------------
+Uint32 SearchSpace::getLowerBound( const Uint16* boxes ) const
+{
+    Uint32 bound = 0;
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+    {
+        Uint16 distance = m_CompiledLevel.getMinPushDistance( boxes[i] );
+        if( distance == CompiledLevel::NO_DISTANCE ) return NO_BOUND;
+        bound += distance;
+    }
+    return bound;
+}
+
+// --------------------------------------------------------------
+Uint32 SearchSpace::getPullLowerBound( const Uint16* boxes ) const
+{
+    Uint32 bound = 0;
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+    {
+        Uint16 distance = m_MinPullDistances[boxes[i]];
+        if( distance == CompiledLevel::NO_DISTANCE ) return NO_BOUND;
+        bound += distance;
+    }
+    return bound;
+}
+
+// --------------------------------------------------------------
+bool SearchSpace::isSolved( const Uint16* boxes ) const
+{
+    for( Uint32 i = 0; i != m_StartBoxes.size(); ++i )
+        if( !m_CompiledLevel.isGoal( boxes[i] ) )
+            return false;
+    return true;
+}
+
+// --------------------------------------------------------------
+void SearchSpace::buildSolution( const Push* pushes, Uint32 count, std::string& solution ) const
+{
+    std::vector<Push> singlePushes;
+    for( Uint32 i = 0; i != count; ++i )
+        this->appendSinglePushes( pushes[i], singlePushes );
+
+    solution.clear();
+    Level level = m_Level.createBranch();
+    std::string walk;
+    for( Uint32 i = 0; i != singlePushes.size(); ++i )
+    {
+        Uint32 side = m_CompiledLevel.getNeighbour( singlePushes[i].from, singlePushes[i].direction ^ 1 );
+        if( !level.findPath( m_CompiledLevel.getX(side), m_CompiledLevel.getY(side), walk ) )
+            throw Exception( "[SearchSpace::buildSolution] push sequence is not valid" );
+        solution += walk;
+        solution += "UDLR"[singlePushes[i].direction];
+        level.applyMoves( walk.data(), walk.size() );
+        level.applyMoves( &solution[solution.size()-1], 1 );
+    }
+}
+
+} // namespace Chocobun
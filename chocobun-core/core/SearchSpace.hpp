@@ -0,0 +1,357 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Search space
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_SEARCH_SPACE_HPP__
+#define __CHOCOBUN_CORE_SEARCH_SPACE_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/Export.hpp>
+#include <core/Level.hpp>
+
+#include <string>
+#include <vector>
+
+namespace Chocobun {
+
+// --------------------------------------------------------------
+// forward declarations
+
+class PatternDatabase;
+
+/*!
+ * @brief A push, as generated by SearchSpace
+ *
+ * With macro moves enabled, a push may stand for several single pushes of
+ * the same box, see SearchSpace::generatePushes.
+ */
+struct Push
+{
+    /*!
+     * @brief The kinds of pushes
+     */
+    enum Macro
+    {
+        MACRO_NONE,         //!< A single push
+        MACRO_TUNNEL,       //!< Pushes in a straight line through a tunnel
+        MACRO_GOAL_ROOM     //!< Pushes in a straight line onto the entrance of a goal room, then along its route to a goal
+    };
+
+    Uint16 box;         //!< Position of the box in the sorted box array
+    Uint16 from;        //!< The cell the box is pushed from
+    Uint16 to;          //!< The cell the box ends up on
+    Uint16 player;      //!< The cell the player ends up on
+    Uint16 pushCount;   //!< The number of single pushes, 1 unless this is a macro push
+    Uint8 direction;    //!< The direction of the (first) push
+    Uint8 macro;        //!< A Macro value
+};
+
+/*!
+ * @brief Buffers used by SearchSpace while generating pushes
+ *
+ * Every thread searching a SearchSpace needs its own scratch buffers. They
+ * are sized on first use and reused afterwards, so searching never
+ * allocates memory.
+ */
+struct SearchScratch
+{
+    SearchScratch( void ) : reachMark( 0 ), boxMark( 0 ), corralMark( 0 ) {}
+
+    std::vector<Uint32> reachMarks;
+    std::vector<Uint32> boxMarks;
+    std::vector<Uint16> stack;
+    Uint32 reachMark;
+    Uint32 boxMark;
+
+    // used by corral pruning
+    std::vector<Uint32> corralMarks;
+    std::vector<Uint32> corralBoxMarks;
+    std::vector<Uint16> corralBoxes;
+    std::vector<Uint16> bestCorralBoxes;
+    Uint32 corralMark;
+};
+
+/*!
+ * @brief The positions of a level as seen by a solver
+ *
+ * A position is stored as the sorted array of the cells (see CompiledLevel)
+ * the boxes are on, plus the cell of the player. Positions where the player
+ * stands in the same area are equal, so the player is normalised to the
+ * lowest cell it can reach.
+ *
+ * Solver uses this class, but any other search over the positions of a
+ * level can use it for move generation as well.
+ *
+ * This class is immutable after construction and can be shared between
+ * threads; all mutable data is kept in a SearchScratch.
+ */
+class CHOCOBUN_CORE_API SearchSpace
+{
+public:
+
+    /*!
+     * @brief Sets up the search space of a validated level
+     *
+     * The search space keeps a branch of the level, so the level itself
+     * may change or be destroyed afterwards.
+     *
+     * @exception Chocobun::Exception If the level hasn't been validated or is too large
+     *
+     * @param level The level. Its current position is the start position
+     * @param isUsingMacroMoves Whether generatePushes returns macro pushes
+     */
+    SearchSpace( const Level& level, bool isUsingMacroMoves = false );
+
+    /*!
+     * @brief Destructor
+     */
+    ~SearchSpace( void );
+
+    /*!
+     * @brief Returns the cell graph of the level
+     */
+    const CompiledLevel& getCompiledLevel( void ) const { return m_CompiledLevel; }
+
+    /*!
+     * @brief Returns the number of boxes which can be moved
+     */
+    Uint32 getBoxCount( void ) const { return static_cast<Uint32>( m_StartBoxes.size() ); }
+
+    /*!
+     * @brief Returns false if the level can't be solved no matter what
+     *
+     * This is the case if a box can't be moved but isn't on a goal, or there
+     * are more boxes than goals the player can reach.
+     */
+    bool isFeasible( void ) const { return m_IsFeasible; }
+
+    /*!
+     * @brief Returns the sorted box cells of the start position
+     */
+    const Uint16* getStartBoxes( void ) const { return m_StartBoxes.data(); }
+
+    /*!
+     * @brief Returns the player cell of the start position (not normalised)
+     */
+    Uint16 getStartPlayer( void ) const { return m_StartPlayer; }
+
+    /*!
+     * @brief Marks the cells the player can reach and returns the lowest of them
+     *
+     * Afterwards, scratch.reachMarks[cell] == scratch.reachMark for every
+     * reachable cell and scratch.boxMarks[cell] == scratch.boxMark for every
+     * cell with a box.
+     */
+    Uint16 markReachable( const Uint16* boxes, Uint16 player, SearchScratch& scratch ) const;
+
+    /*!
+     * @brief Finds every push possible in a position
+     *
+     * Pushes onto dead cells, pushes which freeze the box in a deadlock
+     * (see CompiledLevel::isFreezeDeadlock) and pushes completing a pattern
+     * of the level's pattern database (see Level::setPatternDatabase) are
+     * not generated. If the
+     * position has a PI-corral, only the pushes into it are returned (see
+     * restrictToCorral).
+     *
+     * With macro moves, a box pushed into a tunnel (see
+     * CompiledLevel::isTunnel) with the player following through the
+     * tunnel is pushed on as long as the tunnel goes on and it isn't on a
+     * goal. A box pushed onto the entrance of a goal room (see
+     * CompiledLevel::getGoalRooms) holding boxes on just the first goals of
+     * its order is pushed along the route to the next goal. Either replaces
+     * the single push, which cuts the number of positions searched, but may
+     * skip the positions of some solutions.
+     *
+     * @param boxes The sorted box cells
+     * @param player The player cell
+     * @param scratch Scratch buffers of the calling thread
+     * @param pushes Receives the pushes (cleared first)
+     * @return The normalised player cell of the position
+     */
+    Uint16 generatePushes( const Uint16* boxes, Uint16 player, SearchScratch& scratch, std::vector<Push>& pushes ) const;
+
+    /*!
+     * @brief Finds every push possible in a position just marked by markReachable
+     *
+     * Same as generatePushes, for callers which look the position up by its
+     * normalised player cell before deciding whether its pushes are needed.
+     *
+     * @param boxes The sorted box cells, as passed to markReachable
+     * @param scratch Scratch buffers of the calling thread, as passed to markReachable
+     * @param pushes Receives the pushes (cleared first)
+     */
+    void generateMarkedPushes( const Uint16* boxes, SearchScratch& scratch, std::vector<Push>& pushes ) const;
+
+    /*!
+     * @brief Finds every pull possible in a position
+     *
+     * A pull is the reverse of a push: the player stands next to a box and
+     * steps away from it, dragging the box onto the cell the player stood
+     * on. Pulls are returned as Push values, with the box moving from
+     * Push::from to Push::to in Push::direction and the player ending up
+     * behind it on Push::player. Searches over pulls start at the solved
+     * positions (see findSolvedPositions) and work their way back to the
+     * start position, so pulls onto cells from which no start box cell can
+     * be reached are not generated. There are no macro pulls.
+     *
+     * @param boxes The sorted box cells
+     * @param player The player cell
+     * @param scratch Scratch buffers of the calling thread
+     * @param pulls Receives the pulls (cleared first)
+     * @return The normalised player cell of the position
+     */
+    Uint16 generatePulls( const Uint16* boxes, Uint16 player, SearchScratch& scratch, std::vector<Push>& pulls ) const;
+
+    /*!
+     * @brief Finds the positions a search over pulls starts from
+     *
+     * These are the positions with a box on every goal, one for every area
+     * the player can be in. There are none if the number of goals differs
+     * from the number of boxes, since the boxes could then end up on many
+     * different sets of goals.
+     *
+     * @param scratch Scratch buffers of the calling thread
+     * @param boxes Receives the sorted box cells, which all positions share
+     * @param players Receives the normalised player cell of each position
+     */
+    void findSolvedPositions( SearchScratch& scratch, std::vector<Uint16>& boxes, std::vector<Uint16>& players ) const;
+
+    /*!
+     * @brief Writes the box cells after a push, keeping them sorted
+     *
+     * @return The new position of the pushed box in the sorted array
+     */
+    Uint32 applyPush( const Uint16* boxes, const Push& push, Uint16* result ) const;
+
+    /*!
+     * @brief Returns the Zobrist hash of a set of box cells
+     */
+    Uint64 hashBoxes( const Uint16* boxes ) const;
+
+    /*!
+     * @brief Returns how the box hash changes when a box moves from one cell to another
+     */
+    Uint64 hashPush( const Push& push ) const;
+
+    /*!
+     * @brief Combines a box hash with a normalised player cell into a position hash
+     */
+    Uint64 hashPosition( Uint64 boxHash, Uint16 normalisedPlayer ) const;
+
+    /*!
+     * @brief Returns a lower bound of the pushes needed to solve a position
+     *
+     * This is the sum of the push distances of each box to its nearest goal.
+     *
+     * @return The lower bound, or NO_BOUND if a box can't reach any goal
+     */
+    Uint32 getLowerBound( const Uint16* boxes ) const;
+
+    /*!
+     * @brief Returns the number of pulls needed to get a box from a cell onto a start box cell
+     *
+     * Other boxes are ignored.
+     *
+     * @param startBox The position of the start box cell in getStartBoxes()
+     * @param cell The cell the box is on
+     * @return The number of pulls, or CompiledLevel::NO_DISTANCE if the start box cell can't be reached
+     */
+    Uint16 getPullDistance( Uint32 startBox, Uint32 cell ) const { return m_PullDistances[startBox*m_CompiledLevel.getCellCount() + cell]; }
+
+    /*!
+     * @brief Returns a lower bound of the pulls needed to get back to the start position
+     *
+     * This is the sum of the pull distances of each box to its nearest start
+     * box cell.
+     *
+     * @return The lower bound, or NO_BOUND if a box can't reach any start box cell
+     */
+    Uint32 getPullLowerBound( const Uint16* boxes ) const;
+
+    /*!
+     * @brief Returns true if every box is on a goal
+     */
+    bool isSolved( const Uint16* boxes ) const;
+
+    /*!
+     * @brief Converts a sequence of pushes from the start position into LURD notation
+     *
+     * Macro pushes are turned back into single pushes. The walks between the
+     * pushes are found with Level::findPath on a branch of the level.
+     *
+     * @param pushes The pushes, starting at the start position
+     * @param count The number of pushes
+     * @param solution Receives the moves
+     */
+    void buildSolution( const Push* pushes, Uint32 count, std::string& solution ) const;
+
+    /*!
+     * @brief Returned by getLowerBound if a position can't be solved
+     */
+    static const Uint32 NO_BOUND = 0xFFFFFFFF;
+
+private:
+
+    /*!
+     * @brief Keeps only the pushes into the PI-corral with the fewest pushes, if there is one
+     *
+     * A corral is an area the player can't reach, closed off by boxes. It is
+     * a PI-corral if every push of its boxes goes into it (I) and the player
+     * can make all of those pushes right now (P). If such a corral isn't
+     * solved yet, every solution has to push one of its boxes at some point,
+     * and that push can be made first without changing the number of
+     * pushes. So the other pushes don't need to be searched.
+     *
+     * Expects the marks of markReachable to be up to date.
+     */
+    void restrictToCorral( const Uint16* boxes, SearchScratch& scratch, std::vector<Push>& pushes ) const;
+
+    /*!
+     * @brief Extends a single push into a macro push if possible, see generatePushes
+     */
+    void applyMacro( const Uint16* boxes, const SearchScratch& scratch, Push& push ) const;
+
+    /*!
+     * @brief Appends the single pushes a push stands for
+     *
+     * Only the cells and directions of the single pushes are set.
+     */
+    void appendSinglePushes( const Push& push, std::vector<Push>& pushes ) const;
+
+    Level m_Level;
+    const CompiledLevel& m_CompiledLevel;
+    const PatternDatabase* m_PatternDatabase;
+    std::vector<Uint16> m_StartBoxes;
+    std::vector<Uint64> m_BoxKeys;
+    std::vector<Uint64> m_PlayerKeys;
+    std::vector<Uint16> m_PullDistances;
+    std::vector<Uint16> m_MinPullDistances;
+    Uint16 m_StartPlayer;
+    bool m_IsFeasible;
+    bool m_IsUsingMacroMoves;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_SEARCH_SPACE_HPP__
@@ -0,0 +1,203 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Solution verifier
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/SolutionVerifier.hpp>
+#include <core/CollectionParser.hpp>
+#include <core/Exception.hpp>
+#include <core/Level.hpp>
+#include <core/LevelState.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+namespace Chocobun {
+
+namespace {
+
+// the number of records a thread takes at once
+const Uint32 CHUNK_SIZE = 256;
+
+// --------------------------------------------------------------
+// the levels of a collection file, looked up by name
+struct LoadedCollection
+{
+    std::vector<Level*> levels;
+    std::map<std::string, Level*> levelsByName;
+
+    ~LoadedCollection( void )
+    {
+        for( std::vector<Level*>::iterator it = levels.begin(); it != levels.end(); ++it )
+            delete *it;
+    }
+};
+
+// --------------------------------------------------------------
+// takes chunks of records off the shared counter until there are none left.
+// The levels are only read, see Level::replayMoves
+void work( const std::vector<SolutionVerifier::Record>& records, const std::vector<const Level*>& levels,
+           std::atomic<Uint32>& nextRecord, std::vector<SolutionVerifier::RecordReport>& reports )
+{
+    LevelState state;
+    for( Uint32 first = nextRecord.fetch_add( CHUNK_SIZE ); first < records.size(); first = nextRecord.fetch_add( CHUNK_SIZE ) )
+    {
+        Uint32 last = std::min( first + CHUNK_SIZE, static_cast<Uint32>( records.size() ) );
+        for( Uint32 i = first; i != last; ++i )
+        {
+            SolutionVerifier::RecordReport& report = reports[i];
+            if( !levels[i] )
+            {
+                report.status = SolutionVerifier::STATUS_LEVEL_NOT_FOUND;
+                continue;
+            }
+            const std::string& solution = records[i].solution;
+            report.moves = levels[i]->replayMoves( solution.data(), solution.size(), state, report.pushes );
+            if( report.moves != solution.size() )
+                report.status = SolutionVerifier::STATUS_ILLEGAL_MOVE;
+            else if( levels[i]->isSolved( state ) )
+                report.status = SolutionVerifier::STATUS_SOLVED;
+            else
+                report.status = SolutionVerifier::STATUS_NOT_SOLVED;
+        }
+    }
+}
+
+} // namespace
+
+// --------------------------------------------------------------
+SolutionVerifier::SolutionVerifier( void ) :
+    m_ThreadCount( 0 )
+{
+    m_Report = Report();
+}
+
+// --------------------------------------------------------------
+SolutionVerifier::~SolutionVerifier( void )
+{
+}
+
+// --------------------------------------------------------------
+void SolutionVerifier::setThreadCount( Uint32 count )
+{
+    m_ThreadCount = count;
+}
+
+// --------------------------------------------------------------
+Uint32 SolutionVerifier::getThreadCount( void ) const
+{
+    return m_ThreadCount;
+}
+
+// --------------------------------------------------------------
+void SolutionVerifier::verify( const std::vector<Record>& records )
+{
+    m_Report = Report();
+    m_Report.records.assign( records.size(), RecordReport() );
+
+    // read every file once and look up the level of every record. Reading
+    // and validating change the levels, so this is done before the threads
+    // start. Levels that fail to validate count as not found
+    std::map<std::string, LoadedCollection> collections;
+    std::vector<const Level*> levels( records.size(), static_cast<const Level*>( 0 ) );
+    for( Uint32 i = 0; i != records.size(); ++i )
+    {
+        bool isLoaded = collections.count( records[i].fileName ) != 0;
+        LoadedCollection& collection = collections[records[i].fileName];
+        if( !isLoaded )
+        {
+            try
+            {
+                CollectionParser parser;
+                parser.parse( records[i].fileName, collection.levels );
+            }catch( const Exception& )
+            {
+                // the levels read before the error are still looked up
+            }
+            for( std::vector<Level*>::iterator it = collection.levels.begin(); it != collection.levels.end(); ++it )
+                collection.levelsByName.insert( std::make_pair( (*it)->getLevelName(), *it ) );
+        }
+
+        std::map<std::string, Level*>::iterator level = collection.levelsByName.find( records[i].levelName );
+        if( level != collection.levelsByName.end() && level->second->validateLevel() )
+            levels[i] = level->second;
+    }
+
+    // hardware_concurrency() may not know and return 0
+    Uint32 threadCount = m_ThreadCount;
+    if( threadCount == 0 )
+        threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+    threadCount = std::min( threadCount, std::max( static_cast<Uint32>( (records.size() + CHUNK_SIZE - 1) / CHUNK_SIZE ), 1u ) );
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::atomic<Uint32> nextRecord( 0 );
+    std::vector<std::thread> threads;
+    for( Uint32 i = 0; i != threadCount; ++i )
+        threads.push_back( std::thread( work, std::cref( records ), std::cref( levels ), std::ref( nextRecord ),
+                                        std::ref( m_Report.records ) ) );
+    for( Uint32 i = 0; i != threads.size(); ++i )
+        threads[i].join();
+    m_Report.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+
+    for( std::vector<RecordReport>::const_iterator it = m_Report.records.begin(); it != m_Report.records.end(); ++it )
+    {
+        m_Report.moves += it->moves;
+        switch( it->status )
+        {
+            case STATUS_SOLVED: ++m_Report.solved; break;
+            case STATUS_NOT_SOLVED: ++m_Report.notSolved; break;
+            case STATUS_ILLEGAL_MOVE: ++m_Report.illegalMove; break;
+            case STATUS_LEVEL_NOT_FOUND: ++m_Report.levelNotFound; break;
+        }
+    }
+}
+
+// --------------------------------------------------------------
+const SolutionVerifier::Report& SolutionVerifier::getReport( void ) const
+{
+    return m_Report;
+}
+
+// --------------------------------------------------------------
+void SolutionVerifier::streamReport( std::ostream& stream, const std::vector<Record>& records ) const
+{
+    for( Uint32 i = 0; i != m_Report.records.size() && i != records.size(); ++i )
+    {
+        const RecordReport& report = m_Report.records[i];
+        switch( report.status )
+        {
+            case STATUS_SOLVED: continue;
+            case STATUS_NOT_SOLVED: stream << "not solved after " << report.moves << " moves: "; break;
+            case STATUS_ILLEGAL_MOVE: stream << "illegal move " << report.moves << ": "; break;
+            case STATUS_LEVEL_NOT_FOUND: stream << "level not found: "; break;
+        }
+        stream << records[i].fileName << ", " << records[i].levelName << std::endl;
+    }
+    stream << m_Report.solved << " solved, " << m_Report.notSolved << " not solved, "
+           << m_Report.illegalMove << " with illegal moves, " << m_Report.levelNotFound << " levels not found, out of "
+           << m_Report.records.size() << " solutions. " << m_Report.moves << " moves in " << m_Report.seconds << " s" << std::endl;
+}
+
+} // namespace Chocobun
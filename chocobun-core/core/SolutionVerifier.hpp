@@ -0,0 +1,149 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Solution verifier
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_SOLUTION_VERIFIER_HPP__
+#define __CHOCOBUN_CORE_SOLUTION_VERIFIER_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/Export.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Chocobun {
+
+/*!
+ * @brief Checks many solutions at once on a pool of threads
+ *
+ * Every collection file named by the records is read once, and every
+ * solution is replayed on the level as it was read with
+ * Level::replayMoves, which leaves the level untouched. Threads take the
+ * records in chunks, so batches of many short solutions spread as well as
+ * batches of few long ones.
+ */
+class CHOCOBUN_CORE_API SolutionVerifier
+{
+public:
+
+    /*!
+     * @brief A solution to check
+     */
+    struct Record
+    {
+        std::string fileName;   //!< The collection file the level is in
+        std::string levelName;  //!< The name of the level, the first level of that name is used
+        std::string solution;   //!< The moves in LURD notation
+    };
+
+    /*!
+     * @brief The outcome of checking a solution
+     */
+    enum Status
+    {
+        STATUS_SOLVED,          //!< Every move is legal and the level is solved afterwards
+        STATUS_NOT_SOLVED,      //!< Every move is legal, but the level isn't solved afterwards
+        STATUS_ILLEGAL_MOVE,    //!< A move is blocked or not a LURD character
+        STATUS_LEVEL_NOT_FOUND  //!< The file couldn't be read, has no level of that name or the level is invalid
+    };
+
+    /*!
+     * @brief The outcome of checking a single record
+     */
+    struct RecordReport
+    {
+        Status status;
+        Uint32 moves;   //!< The number of moves made. With STATUS_ILLEGAL_MOVE, also the index of the illegal move
+        Uint32 pushes;  //!< The number of pushes among them
+    };
+
+    /*!
+     * @brief The outcome of checking all records
+     */
+    struct Report
+    {
+        std::vector<RecordReport> records;  //!< In the order the records were passed in
+        Uint32 solved;
+        Uint32 notSolved;
+        Uint32 illegalMove;
+        Uint32 levelNotFound;
+        Uint64 moves;                       //!< The moves made over all records
+        double seconds;                     //!< The time replaying took, without reading the files
+    };
+
+    /*!
+     * @brief Constructor
+     */
+    SolutionVerifier( void );
+
+    /*!
+     * @brief Destructor
+     */
+    ~SolutionVerifier( void );
+
+    /*!
+     * @brief Sets the number of threads replaying solutions
+     *
+     * @param count The number of threads, or 0 to use one thread per
+     * hardware thread. The default is 0
+     */
+    void setThreadCount( Uint32 count );
+
+    /*!
+     * @brief Returns the number of threads replaying solutions, 0 meaning one per hardware thread
+     */
+    Uint32 getThreadCount( void ) const;
+
+    /*!
+     * @brief Checks every record
+     *
+     * The collection files are read again on every call, so edits made to
+     * them in between are picked up. Blocks until all records are checked.
+     *
+     * @param records The solutions to check
+     */
+    void verify( const std::vector<Record>& records );
+
+    /*!
+     * @brief Returns the outcome of the last call to verify
+     */
+    const Report& getReport( void ) const;
+
+    /*!
+     * @brief Streams the records of the last call to verify that didn't pass, followed by the totals
+     *
+     * @param stream The output stream object to stream to
+     * @param records The records passed to verify
+     */
+    void streamReport( std::ostream& stream, const std::vector<Record>& records ) const;
+
+private:
+
+    Report m_Report;
+    Uint32 m_ThreadCount;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_SOLUTION_VERIFIER_HPP__
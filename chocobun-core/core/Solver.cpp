@@ -0,0 +1,797 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Solver
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Solver.hpp>
+#include <core/SearchSpace.hpp>
+#include <core/LowerBound.hpp>
+#include <core/ParallelSearch.hpp>
+#include <core/Exception.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Chocobun {
+
+namespace {
+
+// --------------------------------------------------------------
+// seconds on a monotonic clock
+double getSeconds( void )
+{
+    return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// --------------------------------------------------------------
+// a position reached during an A* search. The box cells are stored
+// separately, getBoxCount() values per node
+struct Node
+{
+    Uint64 hash;
+    Uint64 boxHash;
+    Uint32 parent;
+    Uint16 player;  // normalised
+    Uint16 g;
+    Push push;      // the push leading here from the parent
+};
+
+// --------------------------------------------------------------
+// entry of the open list. Lower f first, deeper nodes first on ties
+struct OpenEntry
+{
+    Uint32 f;
+    Uint32 g;
+    Uint32 node;
+
+    bool operator<( const OpenEntry& other ) const
+    {
+        if( f != other.f ) return f > other.f;
+        return g < other.g;
+    }
+};
+
+// --------------------------------------------------------------
+// open addressing hash table of node indices, keyed by position hash
+class NodeTable
+{
+public:
+
+    NodeTable( void ) : m_Count( 0 ) { m_Slots.assign( 1024, 0 ); }
+
+    // returns the slot holding the node equal to the given one, or the empty
+    // slot it should be inserted into
+    template <class Equal>
+    Uint32* find( Uint64 hash, const Equal& isEqual )
+    {
+        Uint32 mask = static_cast<Uint32>( m_Slots.size() - 1 );
+        for( Uint32 i = static_cast<Uint32>(hash) & mask; ; i = (i+1) & mask )
+            if( m_Slots[i] == 0 || isEqual( m_Slots[i]-1 ) )
+                return &m_Slots[i];
+    }
+
+    // stores a node in a slot returned by find
+    template <class GetHash>
+    void insert( Uint32* slot, Uint32 node, const GetHash& getHash )
+    {
+        *slot = node+1;
+        if( ++m_Count * 2 < m_Slots.size() ) return;
+
+        // grow when half full
+        std::vector<Uint32> old( m_Slots.size() * 2, 0 );
+        old.swap( m_Slots );
+        Uint32 mask = static_cast<Uint32>( m_Slots.size() - 1 );
+        for( std::vector<Uint32>::iterator it = old.begin(); it != old.end(); ++it )
+        {
+            if( *it == 0 ) continue;
+            Uint32 i = static_cast<Uint32>( getHash(*it-1) ) & mask;
+            while( m_Slots[i] ) i = (i+1) & mask;
+            m_Slots[i] = *it;
+        }
+    }
+
+    Uint64 getMemoryUsage( void ) const { return Uint64(m_Slots.size()) * sizeof(Uint32); }
+
+private:
+
+    std::vector<Uint32> m_Slots;
+    Uint32 m_Count;
+};
+
+// --------------------------------------------------------------
+// the positions reached by a best-first search, plus the open list of
+// those still to be expanded
+class SearchTree
+{
+public:
+
+    static const Uint32 NO_NODE = 0xFFFFFFFF;
+
+    explicit SearchTree( Uint32 boxCount ) : m_BoxCount( boxCount ) {}
+
+    const Node& getNode( Uint32 node ) const { return m_Nodes[node]; }
+    const Uint16* getBoxes( Uint32 node ) const { return m_BoxPool.data() + node * m_BoxCount; }
+
+    // returns the node of a position, or NO_NODE if it wasn't reached yet
+    Uint32 find( Uint64 hash, Uint16 player, const Uint16* boxes )
+    {
+        IsEqual isEqual = { *this, boxes, hash, player };
+        Uint32* slot = m_Table.find( hash, isEqual );
+        return *slot ? *slot-1 : NO_NODE;
+    }
+
+    // adds a position with f as its estimated cost, unless it was already
+    // reached with as few pushes. Returns the new node, or NO_NODE
+    Uint32 add( const Node& node, const Uint16* boxes, Uint32 f )
+    {
+        IsEqual isEqual = { *this, boxes, node.hash, node.player };
+        Uint32* slot = m_Table.find( node.hash, isEqual );
+        if( *slot && m_Nodes[*slot-1].g <= node.g )
+            return NO_NODE;
+
+        Uint32 index = static_cast<Uint32>( m_Nodes.size() );
+        m_Nodes.push_back( node );
+        m_BoxPool.insert( m_BoxPool.end(), boxes, boxes + m_BoxCount );
+        if( *slot )
+        {
+            m_Nodes[*slot-1].g = 0xFFFF; // invalidates its open list entry
+            *slot = index+1;
+        }else
+        {
+            GetHash getHash = { m_Nodes };
+            m_Table.insert( slot, index, getHash );
+        }
+
+        OpenEntry entry = { f, node.g, index };
+        m_Open.push( entry );
+        return index;
+    }
+
+    // takes the node to expand next off the open list. Returns false if
+    // the open list is empty
+    bool pop( Uint32& node )
+    {
+        if( this->isOpenEmpty() ) return false;
+        node = m_Open.top().node;
+        m_Open.pop();
+        return true;
+    }
+
+    bool isOpenEmpty( void )
+    {
+        // a shorter path to the node of a stale entry was found since
+        while( !m_Open.empty() && m_Open.top().g != m_Nodes[m_Open.top().node].g )
+            m_Open.pop();
+        return m_Open.empty();
+    }
+
+    // the bytes taken up by the nodes, the open list and the table
+    Uint64 getMemoryUsage( void ) const
+    {
+        return Uint64(m_Nodes.capacity()) * sizeof(Node) + Uint64(m_BoxPool.capacity()) * sizeof(Uint16) +
+               Uint64(m_Open.size()) * sizeof(OpenEntry) + m_Table.getMemoryUsage();
+    }
+
+    // the least estimated cost on the open list, which must not be empty
+    Uint32 getOpenMinF( void ) const { return m_Open.top().f; }
+    Uint32 getOpenCount( void ) const { return static_cast<Uint32>( m_Open.size() ); }
+
+    // appends the pushes from the root to a node
+    void appendPath( Uint32 node, std::vector<Push>& pushes ) const
+    {
+        std::vector<Push>::size_type first = pushes.size();
+        for( ; m_Nodes[node].parent != NO_NODE; node = m_Nodes[node].parent )
+            pushes.push_back( m_Nodes[node].push );
+        std::reverse( pushes.begin() + first, pushes.end() );
+    }
+
+private:
+
+    // compares a candidate position against a stored node
+    struct IsEqual
+    {
+        const SearchTree& tree;
+        const Uint16* boxes;
+        Uint64 hash;
+        Uint16 player;
+        bool operator()( Uint32 node ) const
+        {
+            return tree.m_Nodes[node].hash == hash && tree.m_Nodes[node].player == player &&
+                   std::equal( boxes, boxes + tree.m_BoxCount, tree.getBoxes( node ) );
+        }
+    };
+    struct GetHash
+    {
+        const std::vector<Node>& nodes;
+        Uint64 operator()( Uint32 node ) const { return nodes[node].hash; }
+    };
+
+    Uint32 m_BoxCount;
+    std::vector<Node> m_Nodes;
+    std::vector<Uint16> m_BoxPool;
+    std::priority_queue<OpenEntry> m_Open;
+    NodeTable m_Table;
+};
+
+const Uint32 SearchTree::NO_NODE;
+
+// --------------------------------------------------------------
+// entry of the fixed size IDA* transposition table. Only the hash is
+// stored, so a (very unlikely) collision could prune a position wrongly
+struct TableEntry
+{
+    Uint64 hash;
+    Uint32 iteration;
+    Uint16 g;
+};
+
+} // namespace
+
+// --------------------------------------------------------------
+// everything an IDA* search needs. Buffers are per depth and only grow
+// with the length of the path
+struct Solver::IDAContext
+{
+    IDAContext( const SearchSpace& space, Heuristic heuristic ) : space( space ), lowerBound( space, heuristic ) {}
+
+    const SearchSpace& space;
+    SearchScratch scratch;
+    LowerBound lowerBound;
+    std::vector< std::vector<Push> > pushes;
+    std::vector<Uint16> boxes;
+    std::vector<LowerBound::State> states;
+    std::vector<Push> path;
+    std::vector<TableEntry> table;
+    Uint32 threshold;
+    Uint32 nextThreshold;
+    Uint32 iteration;
+};
+
+// --------------------------------------------------------------
+Solver::Solver( void ) :
+    m_Mode( MODE_ASTAR ),
+    m_Heuristic( HEURISTIC_MATCHING ),
+    m_IsUsingMacroMoves( false ),
+    m_TableSize( 64 ),
+    m_ThreadCount( 0 ),
+    m_NodeLimit( 0 ),
+    m_TimeLimit( 0 ),
+    m_MemoryLimit( 0 ),
+    m_CancelFlag( 0 ),
+    m_StartTime( 0 )
+{
+    m_Statistics = Statistics();
+}
+
+// --------------------------------------------------------------
+Solver::~Solver( void )
+{
+}
+
+// --------------------------------------------------------------
+void Solver::setMode( Mode mode )
+{
+    m_Mode = mode;
+}
+
+// --------------------------------------------------------------
+Solver::Mode Solver::getMode( void ) const
+{
+    return m_Mode;
+}
+
+// --------------------------------------------------------------
+void Solver::setHeuristic( Heuristic heuristic )
+{
+    m_Heuristic = heuristic;
+}
+
+// --------------------------------------------------------------
+Solver::Heuristic Solver::getHeuristic( void ) const
+{
+    return m_Heuristic;
+}
+
+// --------------------------------------------------------------
+void Solver::setMacroMoves( bool enable )
+{
+    m_IsUsingMacroMoves = enable;
+}
+
+// --------------------------------------------------------------
+bool Solver::getMacroMoves( void ) const
+{
+    return m_IsUsingMacroMoves;
+}
+
+// --------------------------------------------------------------
+void Solver::setTableSize( Uint32 megabytes )
+{
+    if( megabytes == 0 )
+        throw Exception( "[Solver::setTableSize] table size must be at least 1 megabyte" );
+    m_TableSize = megabytes;
+}
+
+// --------------------------------------------------------------
+Uint32 Solver::getTableSize( void ) const
+{
+    return m_TableSize;
+}
+
+// --------------------------------------------------------------
+void Solver::setThreadCount( Uint32 count )
+{
+    m_ThreadCount = count;
+}
+
+// --------------------------------------------------------------
+Uint32 Solver::getThreadCount( void ) const
+{
+    return m_ThreadCount;
+}
+
+// --------------------------------------------------------------
+void Solver::setNodeLimit( Uint64 limit )
+{
+    m_NodeLimit = limit;
+}
+
+// --------------------------------------------------------------
+Uint64 Solver::getNodeLimit( void ) const
+{
+    return m_NodeLimit;
+}
+
+// --------------------------------------------------------------
+void Solver::setTimeLimit( double seconds )
+{
+    m_TimeLimit = seconds;
+}
+
+// --------------------------------------------------------------
+double Solver::getTimeLimit( void ) const
+{
+    return m_TimeLimit;
+}
+
+// --------------------------------------------------------------
+void Solver::setMemoryLimit( Uint32 megabytes )
+{
+    m_MemoryLimit = megabytes;
+}
+
+// --------------------------------------------------------------
+Uint32 Solver::getMemoryLimit( void ) const
+{
+    return m_MemoryLimit;
+}
+
+// --------------------------------------------------------------
+void Solver::setCancelFlag( const std::atomic<bool>* flag )
+{
+    m_CancelFlag = flag;
+}
+
+// --------------------------------------------------------------
+Solver::Result Solver::solve( const Level& level )
+{
+    m_Solution.clear();
+    m_Statistics = Statistics();
+    m_StartTime = getSeconds();
+
+    SearchSpace space( level, m_IsUsingMacroMoves );
+    Result result = RESULT_UNSOLVABLE;
+    if( space.isFeasible() )
+    {
+        switch( m_Mode )
+        {
+            case MODE_ASTAR: result = this->solveAStar( space ); break;
+            case MODE_IDASTAR: result = this->solveIDAStar( space ); break;
+            case MODE_PARALLEL: result = this->solveParallel( space ); break;
+            case MODE_BIDIRECTIONAL: result = this->solveBidirectional( space ); break;
+        }
+    }
+
+    m_Statistics.moves = static_cast<Uint32>( m_Solution.size() );
+    m_Statistics.seconds = getSeconds() - m_StartTime;
+    return result;
+}
+
+// --------------------------------------------------------------
+const std::string& Solver::getSolution( void ) const
+{
+    return m_Solution;
+}
+
+// --------------------------------------------------------------
+const Solver::Statistics& Solver::getStatistics( void ) const
+{
+    return m_Statistics;
+}
+
+// --------------------------------------------------------------
+Solver::Result Solver::solveAStar( const SearchSpace& space )
+{
+    const Uint32 boxCount = space.getBoxCount();
+    SearchTree tree( boxCount );
+    SearchScratch scratch;
+    std::vector<Push> pushes;
+    std::vector<Uint16> boxes( boxCount );
+    std::vector<Uint16> childBoxes( boxCount );
+    LowerBound lowerBound( space, m_Heuristic );
+    LowerBound::State state, childState;
+
+    // start position
+    Node start = Node();
+    start.boxHash = space.hashBoxes( space.getStartBoxes() );
+    start.player = space.markReachable( space.getStartBoxes(), space.getStartPlayer(), scratch );
+    start.hash = space.hashPosition( start.boxHash, start.player );
+    start.parent = SearchTree::NO_NODE;
+    m_Statistics.initialLowerBound = lowerBound.compute( space.getStartBoxes(), state );
+    if( m_Statistics.initialLowerBound == SearchSpace::NO_BOUND )
+        return RESULT_UNSOLVABLE;
+    tree.add( start, space.getStartBoxes(), m_Statistics.initialLowerBound );
+
+    Uint32 nodeIndex;
+    while( tree.pop( nodeIndex ) )
+    {
+        // copy the node's boxes, the pool may grow while expanding
+        std::copy( tree.getBoxes( nodeIndex ), tree.getBoxes( nodeIndex ) + boxCount, boxes.begin() );
+        if( space.isSolved( boxes.data() ) )
+        {
+            // collect the pushes leading here and convert them into moves
+            std::vector<Push> solution;
+            tree.appendPath( nodeIndex, solution );
+            space.buildSolution( solution.data(), static_cast<Uint32>( solution.size() ), m_Solution );
+            m_Statistics.pushes = tree.getNode( nodeIndex ).g;
+            return RESULT_SOLVED;
+        }
+
+        // check the limits
+        if( m_NodeLimit && m_Statistics.nodesExpanded >= m_NodeLimit )
+            return RESULT_LIMIT_REACHED;
+        if( (m_Statistics.nodesExpanded & 255) == 0 && this->isLimitReached( tree.getMemoryUsage() ) )
+            return RESULT_LIMIT_REACHED;
+        ++m_Statistics.nodesExpanded;
+
+        // assignments aren't stored with the nodes to save memory, so the
+        // one of the expanded node is solved from scratch and the ones of
+        // its children are derived from it
+        Node parent = tree.getNode( nodeIndex );
+        space.generatePushes( boxes.data(), parent.player, scratch, pushes );
+        if( !pushes.empty() )
+            lowerBound.compute( boxes.data(), state );
+        for( std::vector<Push>::iterator push = pushes.begin(); push != pushes.end(); ++push )
+        {
+            ++m_Statistics.nodesGenerated;
+            Uint32 row = space.applyPush( boxes.data(), *push, childBoxes.data() );
+            Uint32 bound = lowerBound.update( state, childBoxes.data(), push->box, row, childState );
+            if( bound == SearchSpace::NO_BOUND ) continue;
+
+            Node child;
+            child.boxHash = parent.boxHash ^ space.hashPush( *push );
+            child.player = space.markReachable( childBoxes.data(), push->player, scratch );
+            child.hash = space.hashPosition( child.boxHash, child.player );
+            child.parent = nodeIndex;
+            child.g = static_cast<Uint16>( parent.g + push->pushCount );
+            child.push = *push;
+
+            // skip positions which were already reached with as few pushes
+            if( tree.add( child, childBoxes.data(), child.g + bound ) == SearchTree::NO_NODE )
+                ++m_Statistics.duplicates;
+        }
+    }
+
+    return RESULT_UNSOLVABLE;
+}
+
+// --------------------------------------------------------------
+Solver::Result Solver::solveBidirectional( const SearchSpace& space )
+{
+    const Uint32 boxCount = space.getBoxCount();
+    SearchScratch scratch;
+    std::vector<Uint16> goalBoxes;
+    std::vector<Uint16> goalPlayers;
+    space.findSolvedPositions( scratch, goalBoxes, goalPlayers );
+    if( goalPlayers.empty() )
+        return this->solveAStar( space );
+
+    // trees[0] searches forward over pushes from the start position,
+    // trees[1] backward over pulls from the solved positions
+    SearchTree forward( boxCount ), backward( boxCount );
+    SearchTree* trees[2] = { &forward, &backward };
+    LowerBound forwardBound( space, m_Heuristic ), backwardBound( space, m_Heuristic, true );
+    LowerBound* lowerBounds[2] = { &forwardBound, &backwardBound };
+    std::vector<Push> moves;
+    std::vector<Uint16> boxes( boxCount );
+    std::vector<Uint16> childBoxes( boxCount );
+    LowerBound::State state, childState;
+
+    // start position
+    Node start = Node();
+    start.boxHash = space.hashBoxes( space.getStartBoxes() );
+    start.player = space.markReachable( space.getStartBoxes(), space.getStartPlayer(), scratch );
+    start.hash = space.hashPosition( start.boxHash, start.player );
+    start.parent = SearchTree::NO_NODE;
+    m_Statistics.initialLowerBound = forwardBound.compute( space.getStartBoxes(), state );
+    Uint32 goalBound = backwardBound.compute( goalBoxes.data(), state );
+    if( m_Statistics.initialLowerBound == SearchSpace::NO_BOUND || goalBound == SearchSpace::NO_BOUND )
+        return RESULT_UNSOLVABLE;
+    forward.add( start, space.getStartBoxes(), m_Statistics.initialLowerBound );
+
+    // the shortest solution through a position reached from both ends
+    Uint32 best = SearchSpace::NO_BOUND;
+    Uint32 meeting[2] = { SearchTree::NO_NODE, SearchTree::NO_NODE };
+
+    // solved positions. The start position may be one of them
+    Node goal = Node();
+    goal.boxHash = space.hashBoxes( goalBoxes.data() );
+    goal.parent = SearchTree::NO_NODE;
+    for( std::vector<Uint16>::iterator player = goalPlayers.begin(); player != goalPlayers.end(); ++player )
+    {
+        goal.player = *player;
+        goal.hash = space.hashPosition( goal.boxHash, goal.player );
+        Uint32 goalNode = backward.add( goal, goalBoxes.data(), goalBound );
+        Uint32 startNode = forward.find( goal.hash, goal.player, goalBoxes.data() );
+        if( startNode != SearchTree::NO_NODE )
+        {
+            best = 0;
+            meeting[0] = startNode;
+            meeting[1] = goalNode;
+        }
+    }
+
+    for(;;)
+    {
+        // once either side has run dry, every position between the two ends
+        // has been met. Otherwise, stop when no path through the open
+        // positions can be shorter than the best one found
+        if( forward.isOpenEmpty() || backward.isOpenEmpty() )
+            break;
+        if( best != SearchSpace::NO_BOUND && best <= std::max( forward.getOpenMinF(), backward.getOpenMinF() ) )
+            break;
+
+        // check the limits
+        if( m_NodeLimit && m_Statistics.nodesExpanded >= m_NodeLimit )
+            return RESULT_LIMIT_REACHED;
+        if( (m_Statistics.nodesExpanded & 255) == 0 && this->isLimitReached( forward.getMemoryUsage() + backward.getMemoryUsage() ) )
+            return RESULT_LIMIT_REACHED;
+        ++m_Statistics.nodesExpanded;
+
+        // expand the side with fewer positions waiting, which keeps both
+        // about the same size
+        Uint32 side = ( forward.getOpenCount() <= backward.getOpenCount() ? 0 : 1 );
+        SearchTree& tree = *trees[side];
+        SearchTree& other = *trees[side^1];
+        LowerBound& lowerBound = *lowerBounds[side];
+        Uint32 nodeIndex = 0;
+        tree.pop( nodeIndex );
+        std::copy( tree.getBoxes( nodeIndex ), tree.getBoxes( nodeIndex ) + boxCount, boxes.begin() );
+        Node parent = tree.getNode( nodeIndex );
+        if( side == 0 )
+            space.generatePushes( boxes.data(), parent.player, scratch, moves );
+        else
+            space.generatePulls( boxes.data(), parent.player, scratch, moves );
+        if( !moves.empty() )
+            lowerBound.compute( boxes.data(), state );
+
+        for( std::vector<Push>::iterator move = moves.begin(); move != moves.end(); ++move )
+        {
+            ++m_Statistics.nodesGenerated;
+            Uint32 row = space.applyPush( boxes.data(), *move, childBoxes.data() );
+            Uint32 bound = lowerBound.update( state, childBoxes.data(), move->box, row, childState );
+            if( bound == SearchSpace::NO_BOUND ) continue;
+            if( parent.g + move->pushCount + bound >= best ) continue; // can't beat the best solution
+
+            Node child;
+            child.boxHash = parent.boxHash ^ space.hashPush( *move );
+            child.player = space.markReachable( childBoxes.data(), move->player, scratch );
+            child.hash = space.hashPosition( child.boxHash, child.player );
+            child.parent = nodeIndex;
+            child.g = static_cast<Uint16>( parent.g + move->pushCount );
+            child.push = *move;
+
+            Uint32 childIndex = tree.add( child, childBoxes.data(), child.g + bound );
+            if( childIndex == SearchTree::NO_NODE )
+            {
+                ++m_Statistics.duplicates;
+                continue;
+            }
+
+            // the other side knows the way on from here
+            Uint32 match = other.find( child.hash, child.player, childBoxes.data() );
+            if( match != SearchTree::NO_NODE && child.g + other.getNode( match ).g < best )
+            {
+                best = child.g + other.getNode( match ).g;
+                meeting[side] = childIndex;
+                meeting[side^1] = match;
+            }
+        }
+    }
+
+    if( best == SearchSpace::NO_BOUND )
+        return RESULT_UNSOLVABLE;
+
+    // the pulls lead from a solved position to the meeting position, so
+    // the way on is to undo them as pushes in reverse order
+    std::vector<Push> solution;
+    std::vector<Push> pulls;
+    forward.appendPath( meeting[0], solution );
+    backward.appendPath( meeting[1], pulls );
+    for( std::vector<Push>::reverse_iterator pull = pulls.rbegin(); pull != pulls.rend(); ++pull )
+    {
+        Push push = *pull;
+        push.from = pull->to;
+        push.to = pull->from;
+        push.player = pull->to;
+        push.direction ^= 1;
+        solution.push_back( push );
+    }
+    space.buildSolution( solution.data(), static_cast<Uint32>( solution.size() ), m_Solution );
+    m_Statistics.pushes = best;
+    return RESULT_SOLVED;
+}
+
+// --------------------------------------------------------------
+Solver::Result Solver::solveIDAStar( const SearchSpace& space )
+{
+    IDAContext context( space, m_Heuristic );
+    const Uint32 boxCount = space.getBoxCount();
+
+    // the table size is rounded down to a power of two for masking
+    Uint64 entryCount = Uint64(m_TableSize) * 1024 * 1024 / sizeof(TableEntry);
+    Uint64 tableSize = 1;
+    while( tableSize * 2 <= entryCount ) tableSize *= 2;
+    TableEntry empty = { 0, 0, 0 };
+    context.table.assign( static_cast<size_t>(tableSize), empty );
+
+    context.states.resize( 1 );
+    m_Statistics.initialLowerBound = context.lowerBound.compute( space.getStartBoxes(), context.states[0] );
+    if( m_Statistics.initialLowerBound == SearchSpace::NO_BOUND )
+        return RESULT_UNSOLVABLE;
+    context.boxes.assign( space.getStartBoxes(), space.getStartBoxes() + boxCount );
+    Uint64 boxHash = space.hashBoxes( space.getStartBoxes() );
+
+    // deepen the threshold to the lowest f value that exceeded it, until a
+    // solution is found or nothing exceeds it anymore
+    context.threshold = m_Statistics.initialLowerBound;
+    context.iteration = 0;
+    for(;;)
+    {
+        ++context.iteration;
+        ++m_Statistics.iterations;
+        context.nextThreshold = SearchSpace::NO_BOUND;
+        Result result = this->searchIDAStar( context, 0, 0, boxHash, space.getStartPlayer(), m_Statistics.initialLowerBound );
+        if( result == RESULT_SOLVED )
+        {
+            space.buildSolution( context.path.data(), static_cast<Uint32>( context.path.size() ), m_Solution );
+            for( Uint32 i = 0; i != context.path.size(); ++i )
+                m_Statistics.pushes += context.path[i].pushCount;
+        }
+        if( result != RESULT_UNSOLVABLE || context.nextThreshold == SearchSpace::NO_BOUND )
+            return result;
+        context.threshold = context.nextThreshold;
+    }
+}
+
+// --------------------------------------------------------------
+Solver::Result Solver::searchIDAStar( IDAContext& context, Uint32 depth, Uint32 g, Uint64 boxHash, Uint16 player, Uint32 bound )
+{
+    const SearchSpace& space = context.space;
+    const Uint32 boxCount = space.getBoxCount();
+
+    // cut off at the threshold
+    if( bound == SearchSpace::NO_BOUND ) return RESULT_UNSOLVABLE;
+    if( g + bound > context.threshold )
+    {
+        if( g + bound < context.nextThreshold )
+            context.nextThreshold = g + bound;
+        return RESULT_UNSOLVABLE;
+    }
+    if( bound == 0 && space.isSolved( &context.boxes[depth * boxCount] ) )
+    {
+        context.path.resize( depth );
+        return RESULT_SOLVED;
+    }
+
+    // check the limits
+    if( m_NodeLimit && m_Statistics.nodesExpanded >= m_NodeLimit )
+        return RESULT_LIMIT_REACHED;
+    if( (m_Statistics.nodesExpanded & 255) == 0 && this->isLimitReached( 0 ) )
+        return RESULT_LIMIT_REACHED;
+
+    // skip positions already searched with as few pushes in this iteration.
+    // They are found by the player's area, before paying for their pushes
+    Uint16 normalisedPlayer = space.markReachable( &context.boxes[depth * boxCount], player, context.scratch );
+    Uint64 hash = space.hashPosition( boxHash, normalisedPlayer );
+    TableEntry& entry = context.table[static_cast<size_t>( hash & (context.table.size()-1) )];
+    if( entry.hash == hash && entry.iteration == context.iteration && entry.g <= g )
+    {
+        ++m_Statistics.duplicates;
+        return RESULT_UNSOLVABLE;
+    }
+    entry.hash = hash;
+    entry.iteration = context.iteration;
+    entry.g = static_cast<Uint16>( g );
+    ++m_Statistics.nodesExpanded;
+
+    // grow the per depth buffers. They are only accessed by index below,
+    // because deeper calls may grow them again
+    if( context.pushes.size() <= depth )
+    {
+        context.pushes.resize( depth+1 );
+        context.path.resize( depth+1 );
+    }
+    if( context.boxes.size() < (depth+2) * boxCount )
+        context.boxes.resize( (depth+2) * boxCount );
+    if( context.states.size() < depth+2 )
+        context.states.resize( depth+2 );
+    space.generateMarkedPushes( &context.boxes[depth * boxCount], context.scratch, context.pushes[depth] );
+
+    for( Uint32 i = 0; i != context.pushes[depth].size(); ++i )
+    {
+        ++m_Statistics.nodesGenerated;
+        Push push = context.pushes[depth][i];
+        Uint32 row = space.applyPush( &context.boxes[depth * boxCount], push, &context.boxes[(depth+1) * boxCount] );
+        Uint32 childBound = context.lowerBound.update( context.states[depth], &context.boxes[(depth+1) * boxCount], push.box, row, context.states[depth+1] );
+        context.path[depth] = push;
+        Result result = this->searchIDAStar( context, depth+1, g + push.pushCount, boxHash ^ space.hashPush( push ), push.player, childBound );
+        if( result != RESULT_UNSOLVABLE )
+            return result;
+    }
+    return RESULT_UNSOLVABLE;
+}
+
+// --------------------------------------------------------------
+Solver::Result Solver::solveParallel( const SearchSpace& space )
+{
+    // hardware_concurrency() may not know and return 0
+    Uint32 threadCount = m_ThreadCount;
+    if( threadCount == 0 )
+        threadCount = std::max( std::thread::hardware_concurrency(), 1u );
+
+    double timeLimit = 0;
+    if( m_TimeLimit > 0 )
+        timeLimit = std::max( m_TimeLimit - (getSeconds() - m_StartTime), 1e-9 );
+
+    ParallelSearch search( space, m_Heuristic, threadCount, m_TableSize );
+    std::vector<Push> pushes;
+    Result result = search.run( m_NodeLimit, timeLimit, m_CancelFlag, pushes, m_Statistics );
+    if( result == RESULT_SOLVED )
+        space.buildSolution( pushes.data(), static_cast<Uint32>( pushes.size() ), m_Solution );
+    return result;
+}
+
+// --------------------------------------------------------------
+bool Solver::isLimitReached( Uint64 memoryUsed ) const
+{
+    if( m_CancelFlag && m_CancelFlag->load( std::memory_order_relaxed ) )
+        return true;
+    if( m_MemoryLimit && memoryUsed >= Uint64(m_MemoryLimit) << 20 )
+        return true;
+    return m_TimeLimit > 0 && getSeconds() - m_StartTime >= m_TimeLimit;
+}
+
+} // namespace Chocobun
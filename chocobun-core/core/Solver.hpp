@@ -0,0 +1,359 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Solver
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_SOLVER_HPP__
+#define __CHOCOBUN_CORE_SOLVER_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Export.hpp>
+
+#include <atomic>
+#include <string>
+
+namespace Chocobun {
+
+// --------------------------------------------------------------
+// forward declarations
+
+class Level;
+class SearchSpace;
+
+/*!
+ * @brief Finds solutions of levels
+ *
+ * The solver searches over pushes rather than single moves: every position
+ * is a set of box cells plus the area the player can reach, and the walks
+ * between pushes are filled in once a solution is found. All search modes
+ * use an admissible lower bound (see setHeuristic) and a transposition
+ * table, so the solution found has the fewest possible pushes (unless macro
+ * moves are enabled, see setMacroMoves).
+ *
+ * A solver can be reused for any number of levels. The level passed to
+ * solve() is never modified.
+ */
+class CHOCOBUN_CORE_API Solver
+{
+public:
+
+    /*!
+     * @brief The outcome of a search
+     */
+    enum Result
+    {
+        RESULT_SOLVED,          //!< A solution was found
+        RESULT_UNSOLVABLE,      //!< The whole search space was searched without finding a solution
+        RESULT_LIMIT_REACHED    //!< The search was stopped by one of the limits or cancelled (see setCancelFlag)
+    };
+
+    /*!
+     * @brief The search algorithm used
+     */
+    enum Mode
+    {
+        /*!
+         * Best-first search. Every position reached is kept in memory, so
+         * memory usage grows with the size of the search.
+         */
+        MODE_ASTAR,
+
+        /*!
+         * Iterative deepening A*. Only the positions on the current path are
+         * kept, plus a transposition table of fixed size (see setTableSize),
+         * so the search runs in constant memory. Positions are revisited in
+         * every iteration, which costs time instead.
+         */
+        MODE_IDASTAR,
+
+        /*!
+         * Iterative deepening A* searched by several threads (see
+         * setThreadCount). Threads search depth first on their own paths
+         * and steal subtrees from each other, sharing a lock-free
+         * transposition table of fixed size (see setTableSize). Like
+         * MODE_IDASTAR, only the positions on the paths are kept.
+         */
+        MODE_PARALLEL,
+
+        /*!
+         * A* searched from both ends at once: forward over pushes from the
+         * start position, and backward over pulls from every solved
+         * position (see SearchSpace::generatePulls). Each side looks up the
+         * positions it reaches in the other one, and the solution is put
+         * together from both halves where they meet. Neither side has to go
+         * all the way, so far fewer positions are kept in memory, most of
+         * all on levels whose goal areas are easy to clear backwards. Macro
+         * moves are only made forward. Levels with more goals than boxes are
+         * searched forward only, like MODE_ASTAR.
+         */
+        MODE_BIDIRECTIONAL
+    };
+
+    /*!
+     * @brief The lower bound of the pushes needed to solve a position
+     */
+    enum Heuristic
+    {
+        /*!
+         * The sum of the push distances of every box to its nearest goal.
+         * Cheap, but several boxes may count on the same goal.
+         */
+        HEURISTIC_GREEDY,
+
+        /*!
+         * The least sum of push distances with every box on a goal of its
+         * own. Kept up to date incrementally as boxes are pushed, which
+         * takes O(n^2) time per position for n goals.
+         */
+        HEURISTIC_MATCHING
+    };
+
+    /*!
+     * @brief Numbers collected during the last search
+     */
+    struct Statistics
+    {
+        Uint64 nodesExpanded;       //!< Positions whose pushes were generated
+        Uint64 nodesGenerated;      //!< Positions reached by a push
+        Uint64 duplicates;          //!< Generated positions which were already known
+        Uint32 iterations;          //!< The number of iterations (MODE_IDASTAR and MODE_PARALLEL only)
+        Uint32 initialLowerBound;   //!< The lower bound of the start position
+        Uint32 pushes;              //!< The number of pushes of the solution
+        Uint32 moves;               //!< The number of moves of the solution, including pushes
+        double seconds;             //!< The time the search took
+    };
+
+    /*!
+     * @brief Constructor
+     *
+     * No limits are set by default.
+     */
+    Solver( void );
+
+    /*!
+     * @brief Destructor
+     */
+    ~Solver( void );
+
+    /*!
+     * @brief Sets the search algorithm
+     *
+     * @param mode The algorithm to use. The default is MODE_ASTAR
+     */
+    void setMode( Mode mode );
+
+    /*!
+     * @brief Returns the search algorithm
+     */
+    Mode getMode( void ) const;
+
+    /*!
+     * @brief Sets the lower bound used by all search modes
+     *
+     * @param heuristic The lower bound to use. The default is HEURISTIC_MATCHING
+     */
+    void setHeuristic( Heuristic heuristic );
+
+    /*!
+     * @brief Returns the lower bound used by all search modes
+     */
+    Heuristic getHeuristic( void ) const;
+
+    /*!
+     * @brief Enables or disables macro moves in all search modes
+     *
+     * Macro moves push boxes through tunnels and into goal rooms in one go
+     * (see SearchSpace::generatePushes), which makes searches a lot smaller.
+     * They skip some positions though, so solutions found with macro moves
+     * may have more pushes than needed, and some solvable levels may not be
+     * solved at all.
+     *
+     * @param enable True to use macro moves. The default is false
+     */
+    void setMacroMoves( bool enable );
+
+    /*!
+     * @brief Returns true if macro moves are used
+     */
+    bool getMacroMoves( void ) const;
+
+    /*!
+     * @brief Sets the memory used by the transposition table of MODE_IDASTAR and MODE_PARALLEL
+     *
+     * The table is allocated once per search and never grows. When it is
+     * full, older entries are overwritten, which can only cause work to be
+     * repeated.
+     *
+     * @param megabytes The size of the table. The default is 64
+     */
+    void setTableSize( Uint32 megabytes );
+
+    /*!
+     * @brief Returns the memory used by the transposition table of MODE_IDASTAR and MODE_PARALLEL in megabytes
+     */
+    Uint32 getTableSize( void ) const;
+
+    /*!
+     * @brief Sets the number of threads used by MODE_PARALLEL
+     *
+     * @param count The number of threads, or 0 to use one thread per
+     * hardware thread. The default is 0
+     */
+    void setThreadCount( Uint32 count );
+
+    /*!
+     * @brief Returns the number of threads used by MODE_PARALLEL, 0 meaning one per hardware thread
+     */
+    Uint32 getThreadCount( void ) const;
+
+    /*!
+     * @brief Stops searching after expanding this many positions
+     *
+     * @param limit The maximum number of positions to expand, or 0 for no limit
+     */
+    void setNodeLimit( Uint64 limit );
+
+    /*!
+     * @brief Returns the maximum number of positions expanded, 0 meaning no limit
+     */
+    Uint64 getNodeLimit( void ) const;
+
+    /*!
+     * @brief Stops searching after this much time has passed
+     *
+     * @param seconds The maximum search time, or 0 for no limit
+     */
+    void setTimeLimit( double seconds );
+
+    /*!
+     * @brief Returns the maximum search time in seconds, 0 meaning no limit
+     */
+    double getTimeLimit( void ) const;
+
+    /*!
+     * @brief Stops searching once the positions kept in memory take up this much
+     *
+     * Only MODE_ASTAR and MODE_BIDIRECTIONAL keep every position in memory.
+     * The other modes use a fixed amount, see setTableSize.
+     *
+     * @param megabytes The maximum memory used, or 0 for no limit
+     */
+    void setMemoryLimit( Uint32 megabytes );
+
+    /*!
+     * @brief Returns the maximum memory used by MODE_ASTAR and MODE_BIDIRECTIONAL in megabytes, 0 meaning no limit
+     */
+    Uint32 getMemoryLimit( void ) const;
+
+    /*!
+     * @brief Lets another thread stop a running search
+     *
+     * The search checks the flag as often as the time limit and stops with
+     * RESULT_LIMIT_REACHED once it is set. The flag must outlive every
+     * search made while it is set.
+     *
+     * @param flag The flag to watch, or 0 to not watch any. The default is 0
+     */
+    void setCancelFlag( const std::atomic<bool>* flag );
+
+    /*!
+     * @brief Searches for a solution of a level from its current position
+     *
+     * @exception Chocobun::Exception If the level hasn't been validated
+     *
+     * @param level The level to solve
+     * @return The outcome of the search. If it is RESULT_SOLVED, the
+     * solution can be retrieved with getSolution
+     */
+    Result solve( const Level& level );
+
+    /*!
+     * @brief Returns the solution found by the last search in LURD notation
+     *
+     * Pushes are upper case, walks are lower case. The string is empty if no
+     * solution was found.
+     */
+    const std::string& getSolution( void ) const;
+
+    /*!
+     * @brief Returns the statistics of the last search
+     */
+    const Statistics& getStatistics( void ) const;
+
+private:
+
+    /*!
+     * @brief Runs an A* search and writes the solution if one is found
+     */
+    Result solveAStar( const SearchSpace& space );
+
+    /*!
+     * @brief Runs an IDA* search and writes the solution if one is found
+     */
+    Result solveIDAStar( const SearchSpace& space );
+
+    /*!
+     * @brief Runs a parallel IDA* search and writes the solution if one is found
+     */
+    Result solveParallel( const SearchSpace& space );
+
+    /*!
+     * @brief Runs a bidirectional A* search and writes the solution if one is found
+     */
+    Result solveBidirectional( const SearchSpace& space );
+
+    struct IDAContext;
+
+    /*!
+     * @brief Searches the position at the given depth of the current IDA* path
+     *
+     * The lower bound of the position is computed by the caller, so it can
+     * be derived from the position before the last push. The number of
+     * pushes made (g) differs from the depth if macro pushes were made.
+     *
+     * @return RESULT_UNSOLVABLE if no solution was found within the current threshold
+     */
+    Result searchIDAStar( IDAContext& context, Uint32 depth, Uint32 g, Uint64 boxHash, Uint16 player, Uint32 bound );
+
+    /*!
+     * @brief Returns true if the time or memory limit is reached, or the search was cancelled
+     *
+     * @param memoryUsed The bytes taken up by the positions kept in memory
+     */
+    bool isLimitReached( Uint64 memoryUsed ) const;
+
+    std::string m_Solution;
+    Statistics m_Statistics;
+    Mode m_Mode;
+    Heuristic m_Heuristic;
+    bool m_IsUsingMacroMoves;
+    Uint32 m_TableSize;
+    Uint32 m_ThreadCount;
+    Uint64 m_NodeLimit;
+    double m_TimeLimit;
+    Uint32 m_MemoryLimit;
+    const std::atomic<bool>* m_CancelFlag;
+    double m_StartTime;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_SOLVER_HPP__
@@ -0,0 +1,169 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Validator
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Validator.hpp>
+#include <core/Exception.hpp>
+
+namespace Chocobun {
+
+// --------------------------------------------------------------
+Validator::Validator( void ) :
+    m_IsCancelled( false ),
+    m_IsFinished( true ),
+    m_Verdict( VERDICT_UNKNOWN ),
+    m_NodeLimit( 0 ),
+    m_TimeLimit( 10 ),
+    m_MemoryLimit( 256 )
+{
+    m_Solver.setMode( Solver::MODE_ASTAR );
+    m_Solver.setCancelFlag( &m_IsCancelled );
+}
+
+// --------------------------------------------------------------
+Validator::~Validator( void )
+{
+    this->cancel();
+    if( m_Thread.joinable() )
+        m_Thread.join();
+}
+
+// --------------------------------------------------------------
+void Validator::setNodeLimit( Uint64 limit )
+{
+    m_NodeLimit = limit;
+}
+
+// --------------------------------------------------------------
+Uint64 Validator::getNodeLimit( void ) const
+{
+    return m_NodeLimit;
+}
+
+// --------------------------------------------------------------
+void Validator::setTimeLimit( double seconds )
+{
+    m_TimeLimit = seconds;
+}
+
+// --------------------------------------------------------------
+double Validator::getTimeLimit( void ) const
+{
+    return m_TimeLimit;
+}
+
+// --------------------------------------------------------------
+void Validator::setMemoryLimit( Uint32 megabytes )
+{
+    m_MemoryLimit = megabytes;
+}
+
+// --------------------------------------------------------------
+Uint32 Validator::getMemoryLimit( void ) const
+{
+    return m_MemoryLimit;
+}
+
+// --------------------------------------------------------------
+void Validator::start( const Level& level )
+{
+    if( !m_IsFinished )
+        throw Exception( "[Validator::start] a validation is running already" );
+    if( level.getCompiledLevel().getCellCount() == 0 )
+        throw Exception( "[Validator::start] level hasn't been validated" );
+
+    // the last thread has finished, but may not have been joined yet
+    if( m_Thread.joinable() )
+        m_Thread.join();
+
+    m_Level = level.createBranch();
+    m_Solver.setNodeLimit( m_NodeLimit );
+    m_Solver.setTimeLimit( m_TimeLimit );
+    m_Solver.setMemoryLimit( m_MemoryLimit );
+    m_Error = std::exception_ptr();
+    m_Verdict = VERDICT_UNKNOWN;
+    m_IsCancelled = false;
+    m_IsFinished = false;
+    m_Thread = std::thread( &Validator::run, this );
+}
+
+// --------------------------------------------------------------
+bool Validator::isFinished( void ) const
+{
+    return m_IsFinished;
+}
+
+// --------------------------------------------------------------
+void Validator::cancel( void )
+{
+    m_IsCancelled = true;
+}
+
+// --------------------------------------------------------------
+Validator::Verdict Validator::wait( void )
+{
+    if( m_Thread.joinable() )
+        m_Thread.join();
+    if( m_Error )
+    {
+        // only thrown once
+        std::exception_ptr error = m_Error;
+        m_Error = std::exception_ptr();
+        std::rethrow_exception( error );
+    }
+    return m_Verdict;
+}
+
+// --------------------------------------------------------------
+Validator::Verdict Validator::validate( const Level& level )
+{
+    this->start( level );
+    return this->wait();
+}
+
+// --------------------------------------------------------------
+const std::string& Validator::getSolution( void ) const
+{
+    return m_Solver.getSolution();
+}
+
+// --------------------------------------------------------------
+void Validator::run( void )
+{
+    // exceptions can't leave the thread, they are handed to wait
+    try
+    {
+        switch( m_Solver.solve( m_Level ) )
+        {
+            case Solver::RESULT_SOLVED: m_Verdict = VERDICT_SOLVABLE; break;
+            case Solver::RESULT_UNSOLVABLE: m_Verdict = VERDICT_UNSOLVABLE; break;
+            case Solver::RESULT_LIMIT_REACHED: m_Verdict = VERDICT_UNKNOWN; break;
+        }
+    }catch( ... )
+    {
+        m_Error = std::current_exception();
+    }
+    m_IsFinished = true;
+}
+
+} // namespace Chocobun
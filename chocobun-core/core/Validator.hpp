@@ -0,0 +1,191 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Validator
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_VALIDATOR_HPP__
+#define __CHOCOBUN_CORE_VALIDATOR_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+#include <core/Export.hpp>
+#include <core/Level.hpp>
+#include <core/Solver.hpp>
+
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+
+namespace Chocobun {
+
+/*!
+ * @brief Finds out whether levels are solvable within a budget
+ *
+ * Level::validateLevel only checks that a level is well formed. This class
+ * searches for a solution with Solver (MODE_ASTAR, without macro moves, so
+ * a search running out of positions proves the level unsolvable) until a
+ * node, time or memory budget is used up.
+ *
+ * Validations run on a background thread of their own, see start. Only one
+ * validation runs at a time per validator.
+ */
+class CHOCOBUN_CORE_API Validator
+{
+public:
+
+    /*!
+     * @brief The outcome of a validation
+     */
+    enum Verdict
+    {
+        VERDICT_SOLVABLE,   //!< A solution was found, see getSolution
+        VERDICT_UNSOLVABLE, //!< Every position reachable was searched without finding a solution
+        VERDICT_UNKNOWN     //!< The budget was used up or the validation was cancelled
+    };
+
+    /*!
+     * @brief Constructor
+     *
+     * The default budget is 10 seconds and 256 megabytes, with no node limit.
+     */
+    Validator( void );
+
+    /*!
+     * @brief Destructor
+     *
+     * Cancels a running validation and waits for it to stop.
+     */
+    ~Validator( void );
+
+    /*!
+     * @brief Sets the maximum number of positions searched
+     *
+     * Limits apply to validations started afterwards.
+     *
+     * @param limit The number of positions, or 0 for no limit
+     */
+    void setNodeLimit( Uint64 limit );
+
+    /*!
+     * @brief Returns the maximum number of positions searched, 0 meaning no limit
+     */
+    Uint64 getNodeLimit( void ) const;
+
+    /*!
+     * @brief Sets the maximum time a validation takes
+     *
+     * @param seconds The time, or 0 for no limit
+     */
+    void setTimeLimit( double seconds );
+
+    /*!
+     * @brief Returns the maximum time a validation takes in seconds, 0 meaning no limit
+     */
+    double getTimeLimit( void ) const;
+
+    /*!
+     * @brief Sets the maximum memory the positions searched take up
+     *
+     * @param megabytes The memory, or 0 for no limit
+     */
+    void setMemoryLimit( Uint32 megabytes );
+
+    /*!
+     * @brief Returns the maximum memory the positions searched take up in megabytes, 0 meaning no limit
+     */
+    Uint32 getMemoryLimit( void ) const;
+
+    /*!
+     * @brief Starts validating a level on a background thread
+     *
+     * The validator works on a branch of the level (see
+     * Level::createBranch), so the level may change or be destroyed while
+     * the validation runs. Its current position is the start position.
+     *
+     * @exception Chocobun::Exception If the level hasn't been validated, or
+     * a validation is running already
+     *
+     * @param level The level to validate
+     */
+    void start( const Level& level );
+
+    /*!
+     * @brief Returns true if the last validation started has finished
+     *
+     * Use wait to get its verdict. Doesn't block.
+     */
+    bool isFinished( void ) const;
+
+    /*!
+     * @brief Asks the running validation to stop
+     *
+     * Returns right away. The validation stops with VERDICT_UNKNOWN soon
+     * after, unless it was about to finish anyway. Does nothing if no
+     * validation is running.
+     */
+    void cancel( void );
+
+    /*!
+     * @brief Waits for the last validation started to finish
+     *
+     * @exception Any exception thrown while validating is thrown here
+     *
+     * @return The verdict, or VERDICT_UNKNOWN if no validation was started
+     */
+    Verdict wait( void );
+
+    /*!
+     * @brief Validates a level on the calling thread
+     *
+     * Same as start followed by wait.
+     */
+    Verdict validate( const Level& level );
+
+    /*!
+     * @brief Returns the solution found by the last validation in LURD notation
+     *
+     * Only valid after wait returned VERDICT_SOLVABLE, empty otherwise.
+     */
+    const std::string& getSolution( void ) const;
+
+private:
+
+    /*!
+     * @brief Searches the level, runs on the background thread
+     */
+    void run( void );
+
+    Level m_Level;
+    Solver m_Solver;
+    std::thread m_Thread;
+    std::atomic<bool> m_IsCancelled;
+    std::atomic<bool> m_IsFinished;
+    std::exception_ptr m_Error;
+    Verdict m_Verdict;
+    Uint64 m_NodeLimit;
+    double m_TimeLimit;
+    Uint32 m_MemoryLimit;
+};
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_VALIDATOR_HPP__
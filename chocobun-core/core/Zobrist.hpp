@@ -0,0 +1,73 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Zobrist keys
+// --------------------------------------------------------------
+
+#ifndef __CHOCOBUN_CORE_ZOBRIST_HPP__
+#define __CHOCOBUN_CORE_ZOBRIST_HPP__
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/Config.hpp>
+
+namespace Chocobun {
+
+/*!
+ * @brief Generates the random keys used for Zobrist hashing of positions
+ *
+ * Instead of storing a table of random numbers, keys are derived from the
+ * tile index with the SplitMix64 finaliser. This costs a handful of
+ * multiplications, needs no memory, and gives the same keys for every
+ * level, so hashes stay stable across copies and program runs.
+ */
+namespace Zobrist {
+
+    /*!
+     * @brief Mixes a 64-bit value into a well distributed 64-bit key
+     */
+    inline Uint64 mix( Uint64 value )
+    {
+        value += 0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    /*!
+     * @brief Returns the key of a box placed on the given tile index
+     */
+    inline Uint64 getBoxKey( Uint32 index )
+    {
+        return mix( Uint64(index) << 1 );
+    }
+
+    /*!
+     * @brief Returns the key of the player placed on the given tile index
+     */
+    inline Uint64 getPlayerKey( Uint32 index )
+    {
+        return mix( (Uint64(index) << 1) | 1 );
+    }
+
+} // namespace Zobrist
+
+} // namespace Chocobun
+
+#endif // __CHOCOBUN_CORE_ZOBRIST_HPP__
@@ -0,0 +1,304 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Pattern database generator
+//
+// Finds every deadlocked pattern of a window (see PatternDatabase)
+// and writes them to a file.
+//
+// The walls of a window are fixed while its boxes move, so the
+// window is solved once per wall layout. Positions are a set of
+// boxes plus the area the player is in, where area 0 is the one
+// connected to the outside of the window. Positions without boxes
+// are solved; a position is solved if a push leads to a solved
+// position, which is found by repeatedly sweeping the positions
+// with the same number of boxes after those with fewer boxes are
+// done (pushing a box out of the window removes it). A pattern is
+// deadlocked if it has boxes and no area of it is solved, so it is
+// deadlocked no matter where the player is.
+//
+// Wall layouts are independent, so they are spread over threads.
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/PatternDatabase.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace Chocobun;
+
+namespace {
+
+// areas are stored with 4 bits per tile and 16 bit area masks
+const Uint32 MAX_GENERATED_TILES = 16;
+const Uint32 OUTSIDE = 0xFFFFFFFF;
+
+// --------------------------------------------------------------
+// the shape of the window being generated
+struct Window
+{
+    Uint32 width;
+    Uint32 height;
+    Uint32 tileCount;
+    Uint32 neighbours[MAX_GENERATED_TILES][4];
+    Uint64 digits[MAX_GENERATED_TILES];
+};
+
+// --------------------------------------------------------------
+// per thread buffers, indexed by the box mask
+struct Buffers
+{
+    std::vector<Uint64> areas;
+    std::vector<Uint16> solved;
+    std::vector< std::vector<Uint32> > boxMasksByCount;
+};
+
+// --------------------------------------------------------------
+void setupWindow( Window& window, Uint32 width, Uint32 height )
+{
+    window.width = width;
+    window.height = height;
+    window.tileCount = width * height;
+    for( Uint32 tile = 0; tile != window.tileCount; ++tile )
+    {
+        Uint32 x = tile % width, y = tile / width;
+
+        // same direction order as Level: up, down, left, right
+        window.neighbours[tile][0] = y > 0 ? tile - width : OUTSIDE;
+        window.neighbours[tile][1] = y+1 < height ? tile + width : OUTSIDE;
+        window.neighbours[tile][2] = x > 0 ? tile - 1 : OUTSIDE;
+        window.neighbours[tile][3] = x+1 < width ? tile + 1 : OUTSIDE;
+        window.digits[tile] = tile ? window.digits[tile-1] * 3 : 1;
+    }
+}
+
+// --------------------------------------------------------------
+// numbers the areas of free tiles, 4 bits per tile. Area 0 is
+// connected to the outside of the window
+Uint64 findAreas( const Window& window, Uint32 blocked, Uint32& areaCount )
+{
+    Uint8 area[MAX_GENERATED_TILES];
+    std::memset( area, 0xF, sizeof(area) );
+    Uint32 stack[MAX_GENERATED_TILES];
+
+    areaCount = 1;
+    for( Uint32 pass = 0; pass != 2; ++pass )
+    for( Uint32 start = 0; start != window.tileCount; ++start )
+    {
+        if( (blocked >> start) & 1 || area[start] != 0xF ) continue;
+
+        // the first pass only starts at the border
+        bool isBorder = false;
+        for( Uint32 direction = 0; direction != 4; ++direction )
+            if( window.neighbours[start][direction] == OUTSIDE )
+                isBorder = true;
+        if( pass == 0 && !isBorder ) continue;
+
+        Uint8 label = static_cast<Uint8>( pass == 0 ? 0 : areaCount++ );
+        Uint32 top = 0;
+        stack[top++] = start;
+        area[start] = label;
+        while( top )
+        {
+            Uint32 tile = stack[--top];
+            for( Uint32 direction = 0; direction != 4; ++direction )
+            {
+                Uint32 next = window.neighbours[tile][direction];
+                if( next == OUTSIDE || (blocked >> next) & 1 || area[next] != 0xF ) continue;
+                area[next] = label;
+                stack[top++] = next;
+            }
+        }
+    }
+
+    Uint64 areas = 0;
+    for( Uint32 tile = 0; tile != window.tileCount; ++tile )
+        areas |= Uint64(area[tile]) << (tile*4);
+    return areas;
+}
+
+// --------------------------------------------------------------
+Uint32 getArea( Uint64 areas, Uint32 tile )
+{
+    return static_cast<Uint32>( (areas >> (tile*4)) & 0xF );
+}
+
+// --------------------------------------------------------------
+// returns the areas from which a push leads to a solved position
+Uint16 findSolvedAreas( const Window& window, const Buffers& buffers, Uint32 walls, Uint32 boxes )
+{
+    Uint16 solved = 0;
+    Uint32 blocked = walls | boxes;
+    Uint64 areas = buffers.areas[boxes];
+    for( Uint32 box = 0; box != window.tileCount; ++box )
+    {
+        if( !((boxes >> box) & 1) ) continue;
+        for( Uint32 direction = 0; direction != 4; ++direction )
+        {
+            Uint32 side = window.neighbours[box][direction ^ 1];
+            Uint32 to = window.neighbours[box][direction];
+            if( side != OUTSIDE && (blocked >> side) & 1 ) continue;
+            if( to != OUTSIDE && (blocked >> to) & 1 ) continue;
+
+            // boxes pushed out of the window are gone
+            Uint32 nextBoxes = boxes & ~(1u << box);
+            if( to != OUTSIDE ) nextBoxes |= 1u << to;
+            Uint32 nextArea = getArea( buffers.areas[nextBoxes], box );
+            if( (buffers.solved[nextBoxes] >> nextArea) & 1 )
+                solved |= 1u << ( side == OUTSIDE ? 0 : getArea( areas, side ) );
+        }
+    }
+    return solved;
+}
+
+// --------------------------------------------------------------
+void solveWalls( const Window& window, Buffers& buffers, Uint32 walls, std::vector< std::atomic<Uint64> >& patterns )
+{
+    Uint32 free = ((1u << window.tileCount) - 1) & ~walls;
+    for( std::vector< std::vector<Uint32> >::iterator it = buffers.boxMasksByCount.begin(); it != buffers.boxMasksByCount.end(); ++it )
+        it->clear();
+
+    // every subset of the free tiles is a set of boxes
+    for( Uint32 boxes = free;; boxes = (boxes - 1) & free )
+    {
+        Uint32 areaCount;
+        buffers.areas[boxes] = findAreas( window, walls | boxes, areaCount );
+        buffers.solved[boxes] = boxes ? 0 : static_cast<Uint16>( (1u << areaCount) - 1 );
+        Uint32 boxCount = 0;
+        for( Uint32 mask = boxes; mask; mask &= mask - 1 ) ++boxCount;
+        buffers.boxMasksByCount[boxCount].push_back( boxes );
+        if( boxes == 0 ) break;
+    }
+
+    for( Uint32 boxCount = 1; boxCount <= window.tileCount; ++boxCount )
+    {
+        const std::vector<Uint32>& boxMasks = buffers.boxMasksByCount[boxCount];
+        bool isChanged = true;
+        while( isChanged )
+        {
+            isChanged = false;
+            for( Uint32 i = 0; i != boxMasks.size(); ++i )
+            {
+                Uint16 solved = buffers.solved[boxMasks[i]] | findSolvedAreas( window, buffers, walls, boxMasks[i] );
+                if( solved == buffers.solved[boxMasks[i]] ) continue;
+                buffers.solved[boxMasks[i]] = solved;
+                isChanged = true;
+            }
+        }
+
+        for( Uint32 i = 0; i != boxMasks.size(); ++i )
+        {
+            if( buffers.solved[boxMasks[i]] ) continue;
+            Uint64 index = 0;
+            for( Uint32 tile = 0; tile != window.tileCount; ++tile )
+            {
+                if( (walls >> tile) & 1 ) index += window.digits[tile] * PatternDatabase::TILE_WALL;
+                else if( (boxMasks[i] >> tile) & 1 ) index += window.digits[tile] * PatternDatabase::TILE_BOX;
+            }
+            patterns[static_cast<size_t>( index >> 6 )].fetch_or( Uint64(1) << (index & 63), std::memory_order_relaxed );
+        }
+    }
+}
+
+// --------------------------------------------------------------
+void work( const Window& window, std::atomic<Uint32>& nextWalls, std::vector< std::atomic<Uint64> >& patterns )
+{
+    Buffers buffers;
+    buffers.areas.resize( size_t(1) << window.tileCount );
+    buffers.solved.resize( size_t(1) << window.tileCount );
+    buffers.boxMasksByCount.resize( window.tileCount + 1 );
+
+    Uint32 wallLayouts = 1u << window.tileCount;
+    for( Uint32 walls = nextWalls++; walls < wallLayouts; walls = nextWalls++ )
+        solveWalls( window, buffers, walls, patterns );
+}
+
+} // namespace
+
+// --------------------------------------------------------------
+// main entry point
+int main( int argc, char** argv )
+{
+    if( argc < 4 )
+    {
+        std::cerr << "usage: " << argv[0] << " <width> <height> <output file> [threads]" << std::endl;
+        return 1;
+    }
+    Uint32 width = static_cast<Uint32>( std::atoi( argv[1] ) );
+    Uint32 height = static_cast<Uint32>( std::atoi( argv[2] ) );
+    Uint32 threadCount = argc > 4 ? static_cast<Uint32>( std::atoi( argv[4] ) ) : std::thread::hardware_concurrency();
+    if( threadCount == 0 ) threadCount = 1;
+    if( width == 0 || height == 0 || width * height > MAX_GENERATED_TILES )
+    {
+        std::cerr << "windows must have between 1 and " << MAX_GENERATED_TILES << " tiles" << std::endl;
+        return 1;
+    }
+
+    Window window;
+    setupWindow( window, width, height );
+    Uint64 patternBytes = PatternDatabase::getPatternBytes( width, height );
+    std::vector< std::atomic<Uint64> > patterns( static_cast<size_t>( (patternBytes + 7) / 8 ) );
+    for( Uint32 i = 0; i != patterns.size(); ++i )
+        patterns[i] = 0;
+
+    std::cout << "generating " << width << "x" << height << " patterns with " << threadCount << " threads" << std::endl;
+    std::atomic<Uint32> nextWalls( 0 );
+    std::vector<std::thread> threads;
+    for( Uint32 i = 0; i != threadCount; ++i )
+        threads.push_back( std::thread( work, std::cref( window ), std::ref( nextWalls ), std::ref( patterns ) ) );
+    for( Uint32 i = 0; i != threads.size(); ++i )
+        threads[i].join();
+
+    // the bit of pattern i is bit i % 8 of byte i / 8
+    std::ofstream file( argv[3], std::ios::out | std::ios::binary );
+    if( !file.is_open() )
+    {
+        std::cerr << "failed to open \"" << argv[3] << "\"" << std::endl;
+        return 1;
+    }
+    PatternDatabase::Header header;
+    std::memcpy( header.magic, "CHOCOPDB", 8 );
+    header.version = PatternDatabase::VERSION;
+    header.width = width;
+    header.height = height;
+    header.reserved = 0;
+    file.write( reinterpret_cast<const char*>( &header ), sizeof(header) );
+
+    Uint64 deadlockCount = 0;
+    std::vector<char> bytes( static_cast<size_t>( patternBytes ) );
+    for( Uint64 i = 0; i != patternBytes; ++i )
+    {
+        Uint64 word = patterns[static_cast<size_t>( i / 8 )];
+        bytes[static_cast<size_t>(i)] = static_cast<char>( (word >> (8 * (i % 8))) & 0xFF );
+    }
+    for( Uint32 i = 0; i != patterns.size(); ++i )
+        for( Uint64 word = patterns[i]; word; word &= word - 1 )
+            ++deadlockCount;
+    file.write( &bytes[0], bytes.size() );
+
+    std::cout << "wrote " << deadlockCount << " deadlocked patterns to \"" << argv[3] << "\"" << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of Chocobun.
+ *
+ * Chocobun is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Chocobun is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Chocobun.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// --------------------------------------------------------------
+// Solution verifier
+//
+// Checks a batch of solutions against the levels they belong to
+// (see SolutionVerifier). The batch file has one record per line,
+// made up of the collection file, the level name and the solution
+// separated by tabs. The collection files are only read.
+// --------------------------------------------------------------
+
+// --------------------------------------------------------------
+// include files
+
+#include <core/SolutionVerifier.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Chocobun;
+
+// --------------------------------------------------------------
+// main entry point
+int main( int argc, char** argv )
+{
+    if( argc < 2 )
+    {
+        std::cerr << "usage: " << argv[0] << " <batch file> [thread count]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file( argv[1] );
+    if( !file.is_open() )
+    {
+        std::cerr << "unable to open \"" << argv[1] << "\"" << std::endl;
+        return 1;
+    }
+
+    std::vector<SolutionVerifier::Record> records;
+    std::string line;
+    for( Uint32 lineNumber = 1; std::getline( file, line ); ++lineNumber )
+    {
+        if( !line.empty() && line[line.size()-1] == '\r' ) line.erase( line.size()-1 );
+        if( line.empty() ) continue;
+        size_t first = line.find( '\t' );
+        size_t second = first == std::string::npos ? first : line.find( '\t', first+1 );
+        if( second == std::string::npos )
+        {
+            std::cerr << "line " << lineNumber << " isn't a record, skipped" << std::endl;
+            continue;
+        }
+        SolutionVerifier::Record record;
+        record.fileName = line.substr( 0, first );
+        record.levelName = line.substr( first+1, second-first-1 );
+        record.solution = line.substr( second+1 );
+        records.push_back( record );
+    }
+
+    SolutionVerifier verifier;
+    if( argc > 2 )
+        verifier.setThreadCount( std::atoi( argv[2] ) );
+    verifier.verify( records );
+    verifier.streamReport( std::cout, records );
+
+    const SolutionVerifier::Report& report = verifier.getReport();
+    return report.solved == report.records.size() ? 0 : 2;
+}
@@ -33,6 +33,24 @@ if os.get() == "windows" then
 	linklibs_chocobun_console_release = {
 		"chocobun-core"
 	}
+	linklibs_chocobun_patterns_debug = {
+		"chocobun-core_d"
+	}
+	linklibs_chocobun_benchmark_debug = {
+		"chocobun-core_d"
+	}
+	linklibs_chocobun_patterns_release = {
+		"chocobun-core"
+	}
+	linklibs_chocobun_benchmark_release = {
+		"chocobun-core"
+	}
+	linklibs_chocobun_verify_debug = {
+		"chocobun-core_d"
+	}
+	linklibs_chocobun_verify_release = {
+		"chocobun-core"
+	}
 	linklibs_chocobun_sfml_debug = {
 	}
 	linklibs_chocobun_sfml_release = {
@@ -59,8 +77,10 @@ elseif os.get() == "linux" then
 
 	-- link libraries
 	linklibs_chocobun_core_debug = {
+		"pthread"
 	}
 	linklibs_chocobun_core_release = {
+		"pthread"
 	}
 	linklibs_chocobun_console_debug = {
 		"chocobun-core_d"
@@ -68,6 +88,30 @@ elseif os.get() == "linux" then
 	linklibs_chocobun_console_release = {
 		"chocobun-core"
 	}
+	linklibs_chocobun_patterns_debug = {
+		"chocobun-core_d",
+		"pthread"
+	}
+	linklibs_chocobun_patterns_release = {
+		"chocobun-core",
+		"pthread"
+	}
+	linklibs_chocobun_benchmark_debug = {
+		"chocobun-core_d",
+		"pthread"
+	}
+	linklibs_chocobun_benchmark_release = {
+		"chocobun-core",
+		"pthread"
+	}
+	linklibs_chocobun_verify_debug = {
+		"chocobun-core_d",
+		"pthread"
+	}
+	linklibs_chocobun_verify_release = {
+		"chocobun-core",
+		"pthread"
+	}
 	linklibs_chocobun_sfml_debug = {
 	}
 	linklibs_chocobun_sfml_release = {
@@ -104,6 +148,24 @@ elseif os.get() == "macosx" then
 	linklibs_chocobun_console_release = {
 		"chocobun-core"
 	}
+	linklibs_chocobun_patterns_debug = {
+		"chocobun-core_d"
+	}
+	linklibs_chocobun_benchmark_debug = {
+		"chocobun-core_d"
+	}
+	linklibs_chocobun_patterns_release = {
+		"chocobun-core"
+	}
+	linklibs_chocobun_benchmark_release = {
+		"chocobun-core"
+	}
+	linklibs_chocobun_verify_debug = {
+		"chocobun-core_d"
+	}
+	linklibs_chocobun_verify_release = {
+		"chocobun-core"
+	}
 	linklibs_chocobun_sfml_debug = {
 	}
 	linklibs_chocobun_sfml_release = {
@@ -138,6 +200,17 @@ solution "Chocobun"
 	defines {
 		"CHOCOBUN_CORE_DYNAMIC"
 	}
+
+	-------------------------------------------------------------------
+	-- Compiler settings
+	-------------------------------------------------------------------
+	
+	-- C++11 is required (std::shared_ptr)
+	configuration "gmake"
+		buildoptions {
+			"-std=c++11"
+		}
+	configuration {}
 	
 	-------------------------------------------------------------------
 	-- Chocobun core
@@ -215,3 +288,114 @@ solution "Chocobun"
 			}
 			libdirs (libSearchDirs)
 			links (linklibs_chocobun_console_release)
+
+	-------------------------------------------------------------------
+	-- Chocobun pattern database generator
+	-------------------------------------------------------------------
+	
+	project "chocobun-patterns"
+		kind "ConsoleApp"
+		language "C++"
+		files {
+			"chocobun-patterns/**.cpp",
+			"chocobun-patterns/**.hpp"
+		}
+		
+		includedirs (headerSearchDirs)
+		
+		configuration "Debug"
+			targetdir "bin/debug"
+			defines {
+				"DEBUG",
+				"_DEBUG"
+			}
+			flags {
+				"Symbols"
+			}
+			libdirs (libSearchDirs)
+			links (linklibs_chocobun_patterns_debug)
+			
+		configuration "Release"
+			targetdir "bin/release"
+			defines {
+				"NDEBUG"
+			}
+			flags {
+				"Optimize"
+			}
+			libdirs (libSearchDirs)
+			links (linklibs_chocobun_patterns_release)
+
+	-------------------------------------------------------------------
+	-- Chocobun solver benchmark
+	-------------------------------------------------------------------
+	
+	project "chocobun-benchmark"
+		kind "ConsoleApp"
+		language "C++"
+		files {
+			"chocobun-benchmark/**.cpp",
+			"chocobun-benchmark/**.hpp"
+		}
+		
+		includedirs (headerSearchDirs)
+		
+		configuration "Debug"
+			targetdir "bin/debug"
+			defines {
+				"DEBUG",
+				"_DEBUG"
+			}
+			flags {
+				"Symbols"
+			}
+			libdirs (libSearchDirs)
+			links (linklibs_chocobun_benchmark_debug)
+			
+		configuration "Release"
+			targetdir "bin/release"
+			defines {
+				"NDEBUG"
+			}
+			flags {
+				"Optimize"
+			}
+			libdirs (libSearchDirs)
+			links (linklibs_chocobun_benchmark_release)
+
+	-------------------------------------------------------------------
+	-- Chocobun solution verifier
+	-------------------------------------------------------------------
+	
+	project "chocobun-verify"
+		kind "ConsoleApp"
+		language "C++"
+		files {
+			"chocobun-verify/**.cpp",
+			"chocobun-verify/**.hpp"
+		}
+		
+		includedirs (headerSearchDirs)
+		
+		configuration "Debug"
+			targetdir "bin/debug"
+			defines {
+				"DEBUG",
+				"_DEBUG"
+			}
+			flags {
+				"Symbols"
+			}
+			libdirs (libSearchDirs)
+			links (linklibs_chocobun_verify_debug)
+			
+		configuration "Release"
+			targetdir "bin/release"
+			defines {
+				"NDEBUG"
+			}
+			flags {
+				"Optimize"
+			}
+			libdirs (libSearchDirs)
+			links (linklibs_chocobun_verify_release)